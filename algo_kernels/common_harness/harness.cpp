@@ -8,15 +8,18 @@
 #include "kernel_harness.h"
 
 
-int main(int argc, char* argv[]) {
-
-    /* Parse arguments. */
-
+/**
+ * Parsed arguments, and running the algorithm kernel with them.
+ */
+struct KernelRunner {
     size_t threadCount;
     size_t graphTileCount;
     uint64_t maxIters;
     uint32_t numParts;
     bool undirected;
+    bool dynamicSched;
+    std::string affinity;
+    bool async;
 
     std::string edgelistFile;
     std::string partitionFile;
@@ -24,39 +27,61 @@ int main(int argc, char* argv[]) {
 
     AppArgs appArgs;
 
-    int argRet = algoKernelArgs(argc, argv,
-            threadCount, graphTileCount, maxIters, numParts, undirected,
-            edgelistFile, partitionFile, outputFile, appArgs);
+    /**
+     * Load input, run the algorithm kernel, and output.
+     */
+    template<typename GraphType, typename KernelType>
+    int run();
+};
 
-    if (argRet) {
-        algoKernelArgsPrintHelp(appName, appArgs);
-        return argRet;
-    }
+template<typename GraphType, typename KernelType>
+int KernelRunner::run() {
 
     /* Make engine and load input. */
 
-    GraphGASLite::Engine<Graph> engine;
-    engine.graphTileIs(GraphGASLite::GraphIOUtil::graphTilesFromEdgeList<Graph>(
-                threadCount, edgelistFile, partitionFile, 1, undirected, graphTileCount/threadCount, true));
+    // Either merge graph tiles into one tile per thread, or keep all graph
+    // tiles and let threads dynamically claim them.
+    size_t tileCount = dynamicSched ? graphTileCount : threadCount;
+
+    GraphGASLite::Engine<GraphType> engine;
+    engine.graphTileIs(GraphGASLite::GraphIOUtil::graphTilesFromEdgeListIf<GraphType>(
+                tileCount, edgelistFile, partitionFile, 1, undirected, graphTileCount/tileCount, true,
+                [this](const uint64_t srcId, const uint64_t dstId,
+                    const typename GraphType::EdgeType::WeightType& weight) {
+                    return appArgs.edgeLoaded(srcId, dstId, weight);
+                }));
+    engine.workerCountIs(threadCount);
+    if (affinity == "core") {
+        engine.affinityIs(GraphGASLite::Engine<GraphType>::AFFINITY_CORE);
+    } else if (affinity == "socket") {
+        engine.affinityIs(GraphGASLite::Engine<GraphType>::AFFINITY_SOCKET);
+    }
 
     std::cout << "Graph loaded from " << edgelistFile <<
         (partitionFile.empty() ? "" : string(" and ") + partitionFile) <<
         " with " << graphTileCount << " graph tiles, " <<
-        "into " << threadCount << " tiles." <<
+        "into " << tileCount << " tiles" <<
+        (dynamicSched ? " scheduled to " + std::to_string(threadCount) + " threads." : ".") <<
         " Treated as " << (undirected ? "undirected" : "directed") << " graph." <<
         std::endl;
 
     /* Make algorithm kernel. */
 
-    auto kernel = appArgs.algoKernel<Kernel>(appName);
+    auto kernel = appArgs.algoKernel<KernelType>(appName);
     kernel->verboseIs(true);
     kernel->maxItersIs(maxIters);
     kernel->numPartsIs(numParts);
+    if (async && !kernel->asyncAllowed()) {
+        std::cerr << "Algorithm kernel " << appName << " does not allow asynchronous mode." << std::endl;
+        return -1;
+    }
+    kernel->asyncIs(async);
     engine.algoKernelNew(kernel);
 
     std::cout << "Algorithm kernel named " << appName <<
         " is " << algoKernelTagName(kernel->tag()) << ", " <<
-        "with max iterations " << maxIters << " and number of partitions " << numParts << "." <<
+        "with max iterations " << maxIters << " and number of partitions " << numParts <<
+        (async ? ", in asynchronous mode." : ".") <<
         std::endl;
 
     std::cout << "Application parameters: " << appArgs << "." << std::endl;
@@ -70,7 +95,7 @@ int main(int argc, char* argv[]) {
     if (!outputFile.empty()) {
         std::cout << "Output to " << outputFile << "." << std::endl;
         std::ofstream ofs(outputFile);
-        for (size_t tid = 0; tid < threadCount; tid++) {
+        for (size_t tid = 0; tid < engine.graphTileCount(); tid++) {
             auto g = engine.graphTile(tid);
             for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
                 auto v = vIter->second;
@@ -84,3 +109,27 @@ int main(int argc, char* argv[]) {
     return 0;
 }
 
+
+int main(int argc, char* argv[]) {
+
+    /* Parse arguments. */
+
+    KernelRunner runner;
+
+    int argRet = algoKernelArgs(argc, argv,
+            runner.threadCount, runner.graphTileCount, runner.maxIters, runner.numParts,
+            runner.undirected, runner.dynamicSched, runner.affinity, runner.async,
+            runner.edgelistFile, runner.partitionFile, runner.outputFile, runner.appArgs);
+
+    if (argRet) {
+        algoKernelArgsPrintHelp(appName, runner.appArgs);
+        return argRet;
+    }
+
+#ifdef KERNEL_DISPATCH
+    // Kernel harness selects graph and kernel types from the arguments.
+    return kernelDispatch(runner.appArgs, runner);
+#else
+    return runner.run<Graph, Kernel>();
+#endif
+}
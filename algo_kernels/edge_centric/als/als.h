@@ -3,46 +3,15 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdlib>
+#include <limits>
 #include <numeric>
+#include <unordered_map>
+#include <vector>
 #include "graph.h"
 #include "algo_kernel.h"
 
-/*
- * int dgesv(const enum ORDER ord, const int n, const int nrhs,
- *         double* a, const int lda, int* ipiv,
- *         double* b, const int ldb);
- * a: lda x n
- * b: ldb x nrhs
- * ipiv: pivot indices
- * lda/ldb: leading dimension
- * nrhs: number of right hand sides
- */
-#ifdef USE_MKL
-#include "mkl.h"
-template<size_t N>
-void sqmat_ldiv_vec(double* sqmat, double* vec) {
-    lapack_int ipiv[N];
-    LAPACKE_dgesv(LAPACK_ROW_MAJOR, N, 1, sqmat, N, ipiv, vec, 1);
-}
-#else // USE_MKL
-#ifdef USE_ATLAS
-#ifdef __cplusplus
-extern "C"
-{
-#endif
-#include "clapack.h"
-#ifdef __cplusplus
-}
-#endif
-template<size_t N>
-void sqmat_ldiv_vec(double* sqmat, double* vec) {
-    int ipiv[N];
-    clapack_dgesv(CblasRowMajor, N, 1, sqmat, N, ipiv, vec, 1);
-}
-#endif // USE_ATLAS
-#endif // USE_MKL
-
 /*
  * Role of vertex.
  */
@@ -61,12 +30,21 @@ using Vec = std::array<double, R>;
 template<size_t R>
 using Mat = std::array<Vec<R>, R>;
 
+/*
+ * Symmetric matrix, packed upper triangle in row-major order.
+ */
+template<size_t R>
+using SymMat = std::array<double, R * (R + 1) / 2>;
+
 template<size_t R>
 static void veczero(Vec<R>& vec) { std::fill(vec.begin(), vec.end(), 0); }
 
 template<size_t R>
 static void matzero(Mat<R>& mat) { for (auto& vec : mat) veczero(vec); }
 
+template<size_t R>
+static void symmatzero(SymMat<R>& mat) { std::fill(mat.begin(), mat.end(), 0); }
+
 template<size_t R>
 static void veccpy(Vec<R>& dst, const Vec<R>& src) {
     std::copy(src.begin(), src.end(), dst.begin());
@@ -94,6 +72,54 @@ static void matadd(Mat<R>& dst, const Mat<R>& mat1, const Mat<R>& mat2) {
     for (size_t idx = 0; idx < R; idx++) vecadd(dst[idx], mat1[idx], mat2[idx]);
 }
 
+template<size_t R>
+static void symmatadd(SymMat<R>& dst, const SymMat<R>& mat1, const SymMat<R>& mat2) {
+    std::transform(mat1.begin(), mat1.end(), mat2.begin(), dst.begin(),
+            [](const typename SymMat<R>::value_type v1, const typename SymMat<R>::value_type v2){ return v1 + v2; });
+}
+
+/*
+ * mat <= vec * vec^T.
+ */
+template<size_t R>
+static void symmatouter(SymMat<R>& mat, const Vec<R>& vec) {
+    size_t pos = 0;
+    for (size_t idx = 0; idx < R; idx++) {
+        for (size_t jdx = idx; jdx < R; jdx++) {
+            mat[pos++] = vec[idx] * vec[jdx];
+        }
+    }
+}
+
+/*
+ * Unpack into the lower triangle of dst, which is all solve() reads.
+ */
+template<size_t R>
+static void symmatunpack(Mat<R>& dst, const SymMat<R>& mat) {
+    size_t pos = 0;
+    for (size_t idx = 0; idx < R; idx++) {
+        for (size_t jdx = idx; jdx < R; jdx++) {
+            dst[jdx][idx] = mat[pos++];
+        }
+    }
+}
+
+/*
+ * vec^T * mat * vec.
+ */
+template<size_t R>
+static double symmatquad(const SymMat<R>& mat, const Vec<R>& vec) {
+    double val = 0;
+    size_t pos = 0;
+    for (size_t idx = 0; idx < R; idx++) {
+        val += mat[pos++] * vec[idx] * vec[idx];
+        for (size_t jdx = idx + 1; jdx < R; jdx++) {
+            val += 2 * mat[pos++] * vec[idx] * vec[jdx];
+        }
+    }
+    return val;
+}
+
 template<size_t R>
 static typename Vec<R>::value_type vecinprod(const Vec<R>& vec1, const Vec<R>& vec2) {
     constexpr typename Vec<R>::value_type val = 0;
@@ -106,16 +132,36 @@ static typename Vec<R>::value_type vecnormsq(const Vec<R>& vec) {
 }
 
 /*
- * Solve mat \ vec.
+ * Solve mat \ vec in place, for symmetric positive definite mat.
+ *
+ * Use Cholesky decomposition mat = L * L^T. Only the lower triangle of mat is
+ * read, and is overwritten by L. The result is stored in vec.
  */
 template<size_t R>
-void solve(const Mat<R>& mat, Vec<R>& vec) {
-    double linmat[R*R];
-    for (size_t idx = 0; idx < R; idx++)
-        for (size_t jdx = 0; jdx < R; jdx++)
-            linmat[idx * R + jdx] = mat[idx][jdx];
-    double* linvec = vec.data();
-    sqmat_ldiv_vec<R>(linmat, linvec);
+static void solve(Mat<R>& mat, Vec<R>& vec) {
+    for (size_t jdx = 0; jdx < R; jdx++) {
+        double diag = mat[jdx][jdx];
+        for (size_t kdx = 0; kdx < jdx; kdx++) diag -= mat[jdx][kdx] * mat[jdx][kdx];
+        diag = std::sqrt(diag);
+        mat[jdx][jdx] = diag;
+        for (size_t idx = jdx + 1; idx < R; idx++) {
+            double val = mat[idx][jdx];
+            for (size_t kdx = 0; kdx < jdx; kdx++) val -= mat[idx][kdx] * mat[jdx][kdx];
+            mat[idx][jdx] = val / diag;
+        }
+    }
+    // L * y = vec.
+    for (size_t idx = 0; idx < R; idx++) {
+        double val = vec[idx];
+        for (size_t kdx = 0; kdx < idx; kdx++) val -= mat[idx][kdx] * vec[kdx];
+        vec[idx] = val / mat[idx][idx];
+    }
+    // L^T * x = y.
+    for (size_t idx = R; idx-- > 0;) {
+        double val = vec[idx];
+        for (size_t kdx = idx + 1; kdx < R; kdx++) val -= mat[kdx][idx] * vec[kdx];
+        vec[idx] = val / mat[idx][idx];
+    }
 }
 
 
@@ -129,45 +175,61 @@ void solve(const Mat<R>& mat, Vec<R>& vec) {
  */
 template<size_t R>
 struct ALSData {
+    static constexpr size_t rank = R;
+
     Role role;
     Vec<R> features;   // ui, mj
     GraphGASLite::DegreeCount collected;
     Vec<R> vector;     // Vi, Vj
-    Mat<R> matrix;     // Ai, Aj
+    SymMat<R> matrix;  // Ai, Aj
+    double ratingSq;   // sum of squared ratings of the vertex
+    double error;      // squared error of the ratings after the last solve
 
     ALSData(const GraphGASLite::VertexIdx&, const Role role_ = Role::INVALID)
-        : role(role_), collected(0)
+        : role(role_), collected(0), ratingSq(0), error(0)
     {
         veczero(features);
         veczero(vector);
-        matzero(matrix);
+        symmatzero<R>(matrix);
     }
 };
 
 template<size_t R>
 struct ALSUpdate {
     Vec<R> vector;         // Vi, Vj
-    Mat<R> matrix;         // Ai, Aj
+    SymMat<R> matrix;      // Ai, Aj
+    GraphGASLite::DegreeCount count;   // number of edges combined
 
-    ALSUpdate(const Vec<R>& vector_, const Mat<R>& matrix_)
-        : vector(vector_), matrix(matrix_)
+    ALSUpdate(const Vec<R>& vector_, const SymMat<R>& matrix_)
+        : vector(vector_), matrix(matrix_), count(1)
     {
         // Nothing else to do.
     }
 
-    ALSUpdate() {
+    ALSUpdate() : count(0) {
         veczero(vector);
-        matzero(matrix);
+        symmatzero<R>(matrix);
     }
 
     ALSUpdate& operator+=(const ALSUpdate& update) {
         vecadd(vector, vector, update.vector);
-        matadd(matrix, matrix, update.matrix);
+        symmatadd<R>(matrix, matrix, update.matrix);
+        count += update.count;
         return *this;
     }
 };
 
 
+/*
+ * Validation rating, held out from the graph.
+ */
+struct ValidationRating {
+    GraphGASLite::VertexIdx user;
+    GraphGASLite::VertexIdx movie;
+    float rating;
+};
+
+
 /*
  * Algorithm kernel definition.
  */
@@ -176,14 +238,22 @@ class ALSEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<Grap
 public:
     static Ptr<ALSEdgeCentricAlgoKernel> instanceNew(const string& name,
             const GraphGASLite::VertexIdx::Type boundary, const double lambda, const double tolerance,
-            const GraphGASLite::IterCount::Type errEpoch) {
-        return Ptr<ALSEdgeCentricAlgoKernel>(new ALSEdgeCentricAlgoKernel(name, boundary, lambda, tolerance, errEpoch));
+            const GraphGASLite::IterCount::Type errEpoch,
+            const std::vector<ValidationRating>& validation = std::vector<ValidationRating>(),
+            const uint64_t patience = 3) {
+        return Ptr<ALSEdgeCentricAlgoKernel>(new ALSEdgeCentricAlgoKernel(name, boundary, lambda, tolerance, errEpoch,
+                    validation, patience));
     }
 
 protected:
     typedef typename GraphTileType::UpdateType UpdateType;
     typedef typename GraphTileType::VertexType VertexType;
     typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
+    typedef typename GraphGASLite::EdgeCentricAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::EdgeCentricAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+
+    // Latent feature dimension.
+    static constexpr size_t rank = VertexType::DataType::rank;
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
         auto& data = src->data();
@@ -203,12 +273,10 @@ protected:
             // vector <= ui * rij
             std::transform(features.begin(), features.end(), update.vector.begin(),
                     [weight](const double x){ return x * weight; });    // edge weight is rij
-            // matrix <= ui * ui^T
-            for (size_t idx = 0; idx < features.size(); idx++) {
-                for (size_t jdx = 0; jdx < features.size(); jdx++) {
-                    update.matrix[idx][jdx] = features[idx] * features[jdx];
-                }
-            }
+            // matrix <= ui * ui^T, symmetric
+            symmatouter(update.matrix, features);
+
+            update.count = 1;
 
             ret.second = true;
         }
@@ -220,24 +288,35 @@ protected:
         auto ideg = dst->inDeg();
 
         vecadd(data.vector, data.vector, update.vector);
-        matadd(data.matrix, data.matrix, update.matrix);
-        data.collected++;
+        symmatadd<rank>(data.matrix, data.matrix, update.matrix);
+        // Updates to mirror vertices are combined from multiple edges.
+        data.collected += update.count;
 
         if (data.collected == ideg) {
             // matrix <= sum{ ui * ui^T } + lambda * n_ui * E
-            for (size_t idx = 0; idx < data.matrix.size(); idx++) {
-                data.matrix[idx][idx] += lambda_ * ideg;
+            Mat<rank> matrix;
+            symmatunpack(matrix, data.matrix);
+            for (size_t idx = 0; idx < matrix.size(); idx++) {
+                matrix[idx][idx] += lambda_ * ideg;
             }
 
-            // features <= matrix \ vector
-            solve(data.matrix, data.vector);
-            vecdiff(data.features, data.features, data.vector);
+            // features <= matrix \ vector, matrix is SPD.
+            Vec<rank> features;
+            veccpy(features, data.vector);
+            solve(matrix, features);
+
+            // sum{ (rij - ui^T * mj)^2 } = sum{ rij^2 } - 2 * mj^T * vector + mj^T * matrix * mj,
+            // with the accumulated sums before regulation.
+            data.error = data.ratingSq - 2 * vecinprod(features, data.vector)
+                + symmatquad<rank>(data.matrix, features);
+
+            vecdiff(data.features, data.features, features);
             bool converged = (std::abs(vecnormsq(data.features)) < tolerance_ * tolerance_);
-            veccpy(data.features, data.vector);
+            veccpy(data.features, features);
 
             data.collected = 0;
             veczero(data.vector);
-            matzero(data.matrix);
+            symmatzero<rank>(data.matrix);
 
             return converged;
         }
@@ -255,9 +334,12 @@ protected:
 
         // Initialize movie features.
         // First feature is average rating, others are small random numbers (between +/-5).
+        // Also sum up squared ratings. Ratings are undirected, so the out-edges
+        // of a vertex have the same ratings as its in-edges.
         for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
             auto& edge = *edgeIter;
             auto& data = graph->vertex(edge.srcId())->data();
+            data.ratingSq += edge.weight() * edge.weight();
             if (data.role == Role::MOVIE) {
                 data.features[0] += edge.weight();
                 data.collected += 1;
@@ -272,39 +354,171 @@ protected:
                 data.collected = 0;
             }
         }
-    }
 
-    void onIterationEnd(Ptr<GraphTileType>& graph, const GraphGASLite::IterCount& iter) const {
-        if (errEpoch_ != 0 && iter % errEpoch_ == 0) {
-            double err = 0;
-            for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
-                auto& edge = *edgeIter;
-                const auto& srcFeatures = graph->vertex(edge.srcId())->data().features;
-                const auto& dstFeatures = graph->vertex(edge.dstId())->data().features;
-                double diff = edge.weight() - vecinprod(srcFeatures, dstFeatures);
-                err += diff * diff;
+        // Resolve the validation ratings of the users and movies in this tile,
+        // so each rating is resolved once per side. The slots of different
+        // tiles are disjoint.
+        if (!validationIdxs_.empty()) {
+            for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+                const auto& v = vertexIter->second;
+                auto it = validationIdxs_.find(v->vid());
+                if (it == validationIdxs_.end()) continue;
+                auto& resolved = (v->data().role == Role::USER) ? validUsers_ : validMovies_;
+                for (const auto idx : it->second) resolved[idx] = v.get();
             }
-            // Each undirect edge has been counted twice for each direction.
-            err /= 2;
-            info("\tIteration %lu: error %lf", iter.cnt(), err);
         }
     }
 
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool converged) const {
+        bool allConverged = (errEpoch_ == 0 || iter % errEpoch_ != 0)
+            ? cs.barrierAND(workerId, converged)
+            : trainingErrorSync(graphs, cs, workerId, iter, converged);
+
+        // Both sides have been solved after odd iterations.
+        if (!validation_.empty() && (iter.cnt() & 0x1)) {
+            allConverged = validationSync(cs, workerId, iter) || allConverged;
+        }
+        return allConverged;
+    }
+
 protected:
     ALSEdgeCentricAlgoKernel(const string& name,
             const GraphGASLite::VertexIdx::Type boundary, const double lambda, const double tolerance,
-            const GraphGASLite::IterCount::Type errEpoch)
+            const GraphGASLite::IterCount::Type errEpoch,
+            const std::vector<ValidationRating>& validation, const uint64_t patience)
         : GraphGASLite::EdgeCentricAlgoKernel<GraphTileType>(name),
-          boundary_(boundary), lambda_(lambda), tolerance_(tolerance), errEpoch_(errEpoch)
+          boundary_(boundary), lambda_(lambda), tolerance_(tolerance), errEpoch_(errEpoch),
+          validation_(validation), patience_(patience),
+          validUsers_(validation.size(), nullptr), validMovies_(validation.size(), nullptr)
     {
-        // Nothing else to do.
+        for (size_t idx = 0; idx < validation_.size(); idx++) {
+            validationIdxs_[validation_[idx].user].push_back(idx);
+            validationIdxs_[validation_[idx].movie].push_back(idx);
+        }
     }
 
 private:
+    /**
+     * Reduce the training error of the vertices solved in this iteration,
+     * together with convergence.
+     */
+    bool trainingErrorSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool converged) const {
+
+        // Each rating is an in-edge of exactly one vertex solved in this
+        // iteration, whose error has been computed at the solve.
+        const auto solvedRole = (iter.cnt() & 0x1) ? Role::MOVIE : Role::USER;
+        double err = 0;
+        uint64_t count = 0;
+        for (auto& graph : graphs) {
+            for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+                const auto& v = vertexIter->second;
+                if (v->data().role == solvedRole) {
+                    err += v->data().error;
+                    count += v->inDeg().cnt();
+                }
+            }
+        }
+
+        // Reduce error of all tiles together with convergence.
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(converged, err, count),
+                GraphGASLite::TupleCombiner<GraphGASLite::ANDCombiner, GraphGASLite::SumCombiner<double>,
+                    GraphGASLite::SumCombiner<uint64_t>>());
+        if (workerId == 0) {
+            const auto totalCount = std::get<2>(ret);
+            info("\tIteration %lu: error %lf, RMSE %lf", iter.cnt(), std::get<1>(ret),
+                    totalCount ? std::sqrt(std::max(0., std::get<1>(ret)) / totalCount) : 0.);
+        }
+        return std::get<0>(ret);
+    }
+
+    /**
+     * Reduce the validation RMSE, and return whether it has plateaued.
+     *
+     * Must be called after a barrier following the solves. Each worker
+     * evaluates a slice of the validation ratings, and all workers make the
+     * same decision from the reduced error.
+     */
+    bool validationSync(CommSyncType& cs, const uint32_t workerId, const GraphGASLite::IterCount& iter) const {
+        const size_t count = validation_.size();
+        const size_t begin = count * workerId / cs.threadCount();
+        const size_t end = count * (workerId + 1) / cs.threadCount();
+        double err = 0;
+        uint64_t evaluated = 0;
+        for (size_t idx = begin; idx < end; idx++) {
+            const auto vu = validUsers_[idx];
+            const auto vm = validMovies_[idx];
+            // User or movie has no training ratings.
+            if (vu == nullptr || vm == nullptr) continue;
+            const double diff = validation_[idx].rating - vecinprod(vu->data().features, vm->data().features);
+            err += diff * diff;
+            evaluated++;
+        }
+
+        // First validation of this run. All workers grow the states before
+        // the barrier, and each resets its own after it.
+        const bool first = (iter.cnt() == 1);
+        if (first) {
+            mutex_begin(uqlk, stopStatesLock_);
+            if (stopStates_.size() < cs.threadCount()) {
+                stopStates_.resize(cs.threadCount());
+            }
+            mutex_end();
+        }
+
+        // Also keeps the features unchanged until all workers have finished.
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(err, evaluated),
+                GraphGASLite::TupleCombiner<GraphGASLite::SumCombiner<double>, GraphGASLite::SumCombiner<uint64_t>>());
+
+        auto& state = stopStates_[workerId];
+        if (first) state = StopState();
+
+        if (std::get<1>(ret) == 0) return false;
+        const double rmse = std::sqrt(std::get<0>(ret) / std::get<1>(ret));
+
+        if (rmse < state.bestRMSE * (1 - minImprovement)) {
+            state.bestRMSE = rmse;
+            state.staleEpochs = 0;
+        } else {
+            state.staleEpochs++;
+        }
+
+        const bool plateaued = state.staleEpochs >= patience_;
+        if (this->verbose() && workerId == 0) {
+            info("\tIteration %lu: validation RMSE %lf%s", iter.cnt(), rmse, plateaued ? ", plateaued" : "");
+        }
+        return plateaued;
+    }
+
+private:
+    // Relative validation RMSE decrease for an epoch to count as an improvement.
+    static constexpr double minImprovement = 1e-3;
+
+    /**
+     * Early stopping state. Each worker keeps an identical copy.
+     */
+    struct StopState {
+        double bestRMSE = std::numeric_limits<double>::max();
+        uint64_t staleEpochs = 0;
+    };
+
     const GraphGASLite::VertexIdx boundary_;
     const double lambda_;
     const double tolerance_;
     const GraphGASLite::IterCount errEpoch_;
+
+    const std::vector<ValidationRating> validation_;
+    const uint64_t patience_;
+    // Indices of the validation ratings of each user and movie.
+    std::unordered_map< GraphGASLite::VertexIdx::Type, std::vector<size_t> > validationIdxs_;
+    // Resolved vertices of the validation ratings.
+    mutable std::vector<const VertexType*> validUsers_;
+    mutable std::vector<const VertexType*> validMovies_;
+
+    // Indexed by worker. Only resized at the first validation of each run.
+    mutable std::vector<StopState> stopStates_;
+    mutable lock_t stopStatesLock_;
 };
 
 #endif // ALGO_KERNELS_EDGE_CENTRIC_ALS_ALS_H_
@@ -1,23 +1,38 @@
 #ifndef KERNEL_HARNESS_H_
 #define KERNEL_HARNESS_H_
 
+#include <cstdlib>
+#include <vector>
 #include "harness.h"
+#include "graph_io_util.h"
 #include "als.h"
 
-#define R 5
+/*
+ * Ranks (latent feature dimensions) specialized at compile time.
+ */
+template<size_t... Ranks>
+struct RankList { };
 
-typedef GraphGASLite::GraphTile<ALSData<R>, ALSUpdate<R>> Graph;
-typedef ALSEdgeCentricAlgoKernel<Graph> Kernel;
+typedef RankList<4, 5, 8, 10, 16, 20, 32> SupportedRanks;
+
+template<size_t R>
+using Graph = GraphGASLite::GraphTile<ALSData<R>, ALSUpdate<R>>;
+
+template<size_t R>
+using Kernel = ALSEdgeCentricAlgoKernel<Graph<R>>;
 
 const char appName[] = "als";
 
-class AppArgs : public GenericArgs<uint64_t, double, double, uint64_t> {
+class AppArgs : public GenericArgs<uint64_t, double, double, uint64_t, uint64_t, string, uint64_t> {
 public:
-    AppArgs() : GenericArgs<uint64_t, double, double, uint64_t>() {
+    AppArgs() : GenericArgs<uint64_t, double, double, uint64_t, uint64_t, string, uint64_t>() {
         std::get<0>(argTuple_) = boundaryDefault;
         std::get<1>(argTuple_) = lambdaDefault;
         std::get<2>(argTuple_) = toleranceDefault;
         std::get<3>(argTuple_) = errEpochDefault;
+        std::get<4>(argTuple_) = rankDefault;
+        std::get<5>(argTuple_) = "";
+        std::get<6>(argTuple_) = patienceDefault;
     };
 
     const ArgInfo* argInfoList() const {
@@ -28,19 +43,121 @@ public:
             {"", "[tolerance]", "Error tolerance (default " + std::to_string(toleranceDefault) + ")."},
             {"", "[errEpoch]", "Epoch of iterations to calculate error (default "
                 + std::to_string(errEpochDefault) + " means never)."},
+            {"", "[rank]", "Latent feature dimension, 4, 5, 8, 10, 16, 20, or 32 (default "
+                + std::to_string(rankDefault) + ")."},
+            {"", "[validation]", "Validation ratings, either a fraction in (0, 1) of the ratings to hold out,"
+                                 " or an edge list file (default none)."},
+            {"", "[patience]", "Stop after validation RMSE has not improved for this many epochs (default "
+                + std::to_string(patienceDefault) + ")."},
         };
         return list;
     }
 
+    bool isValid() const {
+        if (!arg<5>().empty()) {
+            if (validationNumeric() && (validationFraction() <= 0 || validationFraction() >= 1)) return false;
+            if (arg<6>() == 0) return false;
+        }
+        return rankSupported(arg<4>(), SupportedRanks());
+    }
+
+    bool edgeLoaded(const uint64_t srcId, const uint64_t dstId, const double weight) {
+        if (!validationNumeric() || !heldOut(srcId, dstId, validationFraction())) return true;
+        validation_.push_back(validationRating(srcId, dstId, weight));
+        return false;
+    }
+
+    template<typename KernelType>
+    Ptr<KernelType> algoKernel(const string& kernelName) {
+        if (!arg<5>().empty() && !validationNumeric()) {
+            GraphGASLite::GraphIOUtil::edgeListForEach(arg<5>(), 1.,
+                    [this](const uint64_t srcId, const uint64_t dstId, const double weight) {
+                        validation_.push_back(validationRating(srcId, dstId, weight));
+                    });
+        }
+        if (!validation_.empty()) {
+            std::cout << "Validation set has " << validation_.size() << " ratings." << std::endl;
+        }
+        // Rank is fixed in the kernel type.
+        return KernelType::instanceNew(kernelName, arg<0>(), arg<1>(), arg<2>(), arg<3>(),
+                validation_, arg<6>());
+    }
+
 private:
     static constexpr uint64_t boundaryDefault = 10000000;
     static constexpr double lambdaDefault = 0.05;
     static constexpr double toleranceDefault = 1e-2;
     static constexpr uint64_t errEpochDefault = 0;
+    static constexpr uint64_t rankDefault = 5;
+    static constexpr uint64_t patienceDefault = 3;
+
+    // Held out or read from the validation file.
+    std::vector<ValidationRating> validation_;
+
+    /**
+     * If validation argument is a fraction rather than a file.
+     */
+    bool validationNumeric() const {
+        const char* begin = arg<5>().c_str();
+        char* end = nullptr;
+        std::strtod(begin, &end);
+        return end != begin && *end == '\0';
+    }
+
+    double validationFraction() const {
+        return std::strtod(arg<5>().c_str(), nullptr);
+    }
+
+    ValidationRating validationRating(const uint64_t srcId, const uint64_t dstId, const double weight) const {
+        const bool srcIsUser = srcId < arg<0>();
+        return ValidationRating{srcIsUser ? srcId : dstId, srcIsUser ? dstId : srcId, static_cast<float>(weight)};
+    }
+
+    /**
+     * Deterministically hold out a rating, independent of its direction.
+     */
+    static bool heldOut(const uint64_t srcId, const uint64_t dstId, const double fraction) {
+        uint64_t h = std::min(srcId, dstId) * 0x9e3779b97f4a7c15uL ^ std::max(srcId, dstId);
+        // splitmix64 finalizer.
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9uL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebuL;
+        h ^= h >> 31;
+        return (h >> 11) * (1. / (1uL << 53)) < fraction;
+    }
+
+    static bool rankSupported(const uint64_t, RankList<>) { return false; }
+
+    template<size_t R, size_t... Rs>
+    static bool rankSupported(const uint64_t rank, RankList<R, Rs...>) {
+        return rank == R || rankSupported(rank, RankList<Rs...>());
+    }
 };
 
+/*
+ * Run with the graph and kernel types specialized for the rank argument.
+ */
+template<typename Runner>
+int kernelDispatch(const uint64_t, Runner&, RankList<>) {
+    std::cerr << "Unsupported rank." << std::endl;
+    return -1;
+}
+
+template<typename Runner, size_t R, size_t... Rs>
+int kernelDispatch(const uint64_t rank, Runner& runner, RankList<R, Rs...>) {
+    if (rank == R) return runner.template run<Graph<R>, Kernel<R>>();
+    return kernelDispatch(rank, runner, RankList<Rs...>());
+}
+
+template<typename Runner>
+int kernelDispatch(const AppArgs& appArgs, Runner& runner) {
+    return kernelDispatch(appArgs.arg<4>(), runner, SupportedRanks());
+}
+
+#define KERNEL_DISPATCH
+
 #define VDATA(vd) std::accumulate(vd.features.begin(), vd.features.end(), string(""),\
         [](const string str, const double a){ return str + " " + std::to_string(a); })
 
 #endif // KERNEL_HARNESS_H_
-
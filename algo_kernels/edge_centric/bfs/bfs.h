@@ -0,0 +1,287 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_BFS_BFS_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_BFS_BFS_H_
+
+#include <atomic>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+#define INV_VID -1uL
+
+/*
+ * Direction-optimizing BFS.
+ *
+ * Frontiers are bitmaps over the dense vertex indices of each tile, and
+ * vertices of other tiles are claimed directly in the next frontier bitmap
+ * of their tiles with atomic bit sets, rather than sent as updates. The
+ * claiming tile also sets the parent, so each vertex only keeps three bits
+ * and its parent during the search.
+ *
+ * Each iteration is either top-down, i.e., frontier vertices claim their
+ * unvisited out-neighbors, or bottom-up, i.e., unvisited vertices look for a
+ * frontier in-neighbor and stop at the first one found. The direction is
+ * switched with the heuristics in Beamer et al., SC'12.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct BFSData {
+    GraphGASLite::VertexIdx::Type parent;
+
+    BFSData(const GraphGASLite::VertexIdx&)
+        : parent(INV_VID)
+    {
+        // Nothing else to do.
+    }
+};
+
+// Not used, frontiers are exchanged as bitmaps.
+typedef GraphGASLite::VertexIdx::Type BFSUpdate;
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class BFSAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<BFSAlgoKernel> instanceNew(const string& name,
+            const GraphGASLite::VertexIdx& src, const double alpha, const double beta) {
+        return Ptr<BFSAlgoKernel>(new BFSAlgoKernel(name, src, alpha, beta));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+        // Tile and dense index of the master of each mirror vertex.
+        std::vector< std::pair<uint32_t, uint32_t> > mirrorMasters;
+
+        // Bitmaps of local vertices. Next frontier is set by any tile.
+        std::vector<uint64_t> frontier;
+        std::vector<uint64_t> visited;
+        std::unique_ptr<std::atomic<uint64_t>[]> next;
+        // Set by the tile that claims the vertex.
+        std::vector<GraphGASLite::VertexIdx::Type> parent;
+
+        // Statistics of the current frontier.
+        uint64_t prevFrontierCount;
+        uint64_t frontierCount;
+        uint64_t frontierEdges;
+        // Out-edges of the unvisited vertices.
+        uint64_t unexploredEdges;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), frontier(wordCount(), 0), visited(wordCount(), 0), next(new std::atomic<uint64_t>[wordCount()]),
+              parent(csc.vertexCount(), INV_VID),
+              prevFrontierCount(0), frontierCount(0), frontierEdges(0), unexploredEdges(graph->edgeCount())
+        {
+            for (size_t w = 0; w < wordCount(); w++) next[w].store(0, std::memory_order_relaxed);
+        }
+
+        size_t wordCount() const { return (csc.vertexCount() + 63) / 64; }
+
+        uint64_t outDeg(const uint32_t idx) const { return csc.outEdgeOffsets()[idx + 1] - csc.outEdgeOffsets()[idx]; }
+
+        static bool bit(const std::vector<uint64_t>& bitmap, const uint32_t idx) {
+            return (bitmap[idx / 64] >> (idx % 64)) & 0x1;
+        }
+
+        bool claimed(const uint32_t idx) const {
+            return bit(visited, idx) || ((next[idx / 64].load(std::memory_order_relaxed) >> (idx % 64)) & 0x1);
+        }
+
+        /**
+         * Claim an unvisited vertex for the next frontier. Only one claim
+         * succeeds, which sets the parent.
+         */
+        bool claim(const uint32_t idx, const GraphGASLite::VertexIdx::Type par) {
+            if (claimed(idx)) return false;
+            const uint64_t mask = 1uL << (idx % 64);
+            if (next[idx / 64].fetch_or(mask, std::memory_order_relaxed) & mask) return false;
+            parent[idx] = par;
+            return true;
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType&, const GraphGASLite::IterCount& iter) const {
+        auto& state = *states_[graph->tid()];
+        const auto vertexCount = state.csc.vertexCount();
+
+        if (iter == 0) {
+            // All tiles have been started.
+            state.mirrorMasters.resize(graph->mirrorVertexCount());
+            for (uint32_t m = 0; m < graph->mirrorVertexCount(); m++) {
+                const auto& mv = graph->mirrorVertexAt(m);
+                const auto mtid = mv.masterTileId();
+                state.mirrorMasters[m] = std::make_pair(mtid, states_[mtid]->csc.vertexIdx(mv.vid()));
+            }
+        }
+
+        // Tile state and dense index of a target.
+        auto targetMaster = [&](const uint32_t t) {
+            if (t < vertexCount) return std::make_pair(&state, t);
+            const auto& master = state.mirrorMasters[t - vertexCount];
+            return std::make_pair(states_[master.first].get(), master.second);
+        };
+
+        if (!bottomUp_.load(std::memory_order_relaxed)) {
+            for (size_t w = 0; w < state.frontier.size(); w++) {
+                for (auto word = state.frontier[w]; word != 0; word &= word - 1) {
+                    const uint32_t s = w * 64 + __builtin_ctzll(word);
+                    const auto vid = state.csc.vertexAt(s)->vid();
+                    for (auto e = state.csc.outEdgeOffsets()[s]; e < state.csc.outEdgeOffsets()[s+1]; e++) {
+                        const auto dst = targetMaster(state.csc.outEdgeTargets()[e]);
+                        dst.first->claim(dst.second, vid);
+                    }
+                }
+            }
+        } else {
+            const auto& offsets = state.csc.inEdgeOffsets();
+            const auto& srcs = state.csc.inEdgeSrcs();
+            for (uint32_t t = 0; t < state.csc.targetCount(); t++) {
+                const auto dst = targetMaster(t);
+                if (dst.first->claimed(dst.second)) continue;
+                for (auto e = offsets[t]; e < offsets[t+1]; e++) {
+                    if (TileState::bit(state.frontier, srcs[e])) {
+                        dst.first->claim(dst.second, state.csc.vertexAt(srcs[e])->vid());
+                        break;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType&, const GraphGASLite::IterCount&) const {
+        auto& state = *states_[graph->tid()];
+
+        // All tiles have finished claiming. Advance the frontier.
+        state.prevFrontierCount = state.frontierCount;
+        state.frontierCount = 0;
+        state.frontierEdges = 0;
+        for (size_t w = 0; w < state.frontier.size(); w++) {
+            const auto word = state.next[w].exchange(0, std::memory_order_relaxed);
+            state.frontier[w] = word;
+            state.visited[w] |= word;
+            for (auto bits = word; bits != 0; bits &= bits - 1) {
+                state.frontierCount++;
+                state.frontierEdges += state.outDeg(w * 64 + __builtin_ctzll(bits));
+            }
+        }
+        state.unexploredEdges -= state.frontierEdges;
+
+        return state.frontierCount == 0;
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool) const {
+        uint64_t prevFrontierCount = 0;
+        uint64_t frontierCount = 0;
+        uint64_t frontierEdges = 0;
+        uint64_t unexploredEdges = 0;
+        uint64_t vertexCount = 0;
+        // Read before the reduction, after which other workers may store the
+        // next direction.
+        bool bottomUp = bottomUp_.load(std::memory_order_relaxed);
+        for (auto& graph : graphs) {
+            const auto& state = *states_[graph->tid()];
+            prevFrontierCount += state.prevFrontierCount;
+            frontierCount += state.frontierCount;
+            frontierEdges += state.frontierEdges;
+            unexploredEdges += state.unexploredEdges;
+            vertexCount += state.csc.vertexCount();
+        }
+        auto ret = cs.barrierReduce(workerId,
+                std::make_tuple(prevFrontierCount, frontierCount, frontierEdges, unexploredEdges, vertexCount),
+                GraphGASLite::TupleCombiner<GraphGASLite::SumCombiner<uint64_t>,
+                    GraphGASLite::SumCombiner<uint64_t>, GraphGASLite::SumCombiner<uint64_t>,
+                    GraphGASLite::SumCombiner<uint64_t>, GraphGASLite::SumCombiner<uint64_t>>());
+        std::tie(prevFrontierCount, frontierCount, frontierEdges, unexploredEdges, vertexCount) = ret;
+
+        if (frontierCount == 0) return true;
+
+        // Go bottom-up when the growing frontier has many edges to check, and
+        // back to top-down when the shrinking frontier is small.
+        const bool growing = frontierCount > prevFrontierCount;
+        if (!bottomUp) {
+            bottomUp = growing && frontierEdges > unexploredEdges / alpha_;
+        } else {
+            bottomUp = growing || frontierCount >= vertexCount / beta_;
+        }
+
+        if (this->verbose() && workerId == 0) {
+            info("\tIteration %lu: frontier %lu, %s", iter.cnt(), frontierCount, bottomUp ? "bottom-up" : "top-down");
+        }
+
+        // All workers decide the same direction, used by the next iteration.
+        bottomUp_.store(bottomUp, std::memory_order_relaxed);
+        return false;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+
+        // Source vertex is the first frontier.
+        if (graph->vertex(src_)) {
+            const auto idx = state->csc.vertexIdx(src_);
+            state->frontier[idx / 64] |= 1uL << (idx % 64);
+            state->visited[idx / 64] |= 1uL << (idx % 64);
+            state->parent[idx] = src_;
+            state->frontierCount = 1;
+            state->frontierEdges = state->outDeg(idx);
+            state->unexploredEdges -= state->frontierEdges;
+        }
+
+        states_.stateIs(graph->tid(), state);
+        bottomUp_.store(false, std::memory_order_relaxed);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            state->csc.vertexAt(idx)->data().parent = state->parent[idx];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    BFSAlgoKernel(const string& name, const GraphGASLite::VertexIdx& src, const double alpha, const double beta)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name),
+          src_(src), alpha_(alpha), beta_(beta), bottomUp_(false)
+    {
+        if (alpha_ <= 0) {
+            throw InvalidArgumentException("alpha");
+        }
+        if (beta_ <= 0) {
+            throw InvalidArgumentException("beta");
+        }
+    }
+
+private:
+    const GraphGASLite::VertexIdx src_;
+    const double alpha_;
+    const double beta_;
+
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+    // Direction of the current iteration, for all tiles.
+    mutable std::atomic<bool> bottomUp_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_BFS_BFS_H_
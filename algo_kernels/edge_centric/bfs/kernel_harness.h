@@ -0,0 +1,43 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include "harness.h"
+#include "bfs.h"
+
+typedef GraphGASLite::GraphTile<BFSData, BFSUpdate> Graph;
+typedef BFSAlgoKernel<Graph> Kernel;
+
+const char appName[] = "bfs";
+
+class AppArgs : public GenericArgs<uint64_t, double, double> {
+public:
+    AppArgs() : GenericArgs<uint64_t, double, double>() {
+        std::get<0>(argTuple_) = srcDefault;
+        std::get<1>(argTuple_) = alphaDefault;
+        std::get<2>(argTuple_) = betaDefault;
+    };
+
+    const ArgInfo* argInfoList() const {
+        static const ArgInfo list[] = {
+            {"", "[src]", "Source vertex index (default " + std::to_string(srcDefault) + ")."},
+            {"", "[alpha]", "Go bottom-up when frontier edges exceed unexplored edges / alpha (default "
+                + std::to_string(alphaDefault) + ")."},
+            {"", "[beta]", "Go top-down when frontier vertices are fewer than all vertices / beta (default "
+                + std::to_string(betaDefault) + ")."},
+        };
+        return list;
+    }
+
+    bool isValid() const {
+        return arg<1>() > 0 && arg<2>() > 0;
+    }
+
+private:
+    static constexpr uint64_t srcDefault = 0;
+    static constexpr double alphaDefault = 15;
+    static constexpr double betaDefault = 18;
+};
+
+#define VDATA(vd) (vd.parent == INV_VID ? "none" : std::to_string(vd.parent))
+
+#endif // KERNEL_HARNESS_H_
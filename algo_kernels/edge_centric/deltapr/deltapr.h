@@ -0,0 +1,153 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_DELTAPR_DELTAPR_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_DELTAPR_DELTAPR_H_
+
+#include "graph.h"
+#include "algo_kernel.h"
+
+/*
+ * Delta-based PageRank.
+ *
+ * Each vertex accumulates the rank changes it receives as a residual, and
+ * only propagates the residual when it exceeds the threshold. So the active
+ * vertices, and the messages, decay over iterations.
+ *
+ * A residual left behind also misses its damped echoes through the rest of
+ * the graph, so the threshold is the tolerance scaled by (1 - beta)^2 to keep
+ * the final error of each rank within the tolerance.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct DeltaPageRankData {
+    double rank;
+    // Received but not yet propagated rank change.
+    double residual;
+    // Received in the current iteration.
+    double acc;
+    // Propagate the residual in this iteration.
+    GraphGASLite::IterCount activeIter;
+
+    DeltaPageRankData(const GraphGASLite::VertexIdx&)
+        : rank(0), residual(0), acc(0), activeIter(-1)
+    {
+        // Nothing else to do.
+    }
+};
+
+struct DeltaPageRankUpdate {
+    double contribute;
+
+    DeltaPageRankUpdate(const double contribute_ = 0)
+        : contribute(contribute_)
+    {
+        // Nothing else to do.
+    }
+
+    DeltaPageRankUpdate& operator+=(const DeltaPageRankUpdate& update) {
+        contribute += update.contribute;
+        return *this;
+    }
+};
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class DeltaPageRankEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, DeltaPageRankEdgeCentricAlgoKernel<GraphTileType>> {
+    typedef GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, DeltaPageRankEdgeCentricAlgoKernel<GraphTileType>> BaseKernelType;
+    friend BaseKernelType;
+
+public:
+    static Ptr<DeltaPageRankEdgeCentricAlgoKernel> instanceNew(const string& name,
+            const double beta, const double tolerance) {
+        return Ptr<DeltaPageRankEdgeCentricAlgoKernel>(new DeltaPageRankEdgeCentricAlgoKernel(name, beta, tolerance));
+    }
+
+protected:
+    typedef typename GraphTileType::UpdateType UpdateType;
+    typedef typename GraphTileType::VertexType VertexType;
+    typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
+    typedef typename BaseKernelType::CommSyncType CommSyncType;
+    typedef typename BaseKernelType::GraphTileList GraphTileList;
+
+    std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType&) const {
+        auto& data = src->data();
+        if (data.activeIter != iter) {
+            return std::make_pair(DeltaPageRankUpdate(), false);
+        }
+        return std::make_pair(DeltaPageRankUpdate(beta_ * data.residual / src->outDeg()), true);
+    }
+
+    bool gather(const GraphGASLite::IterCount&, Ptr<VertexType>& dst, const UpdateType& update) const {
+        dst->data().acc += update.contribute;
+        // Convergency is decided after all updates are applied.
+        return true;
+    }
+
+    void onIterationEnd(Ptr<GraphTileType>& graph, const GraphGASLite::IterCount& iter) const {
+        for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+            auto& v = vertexIter->second;
+            auto& data = v->data();
+            // Residual has been propagated, or has nowhere to go.
+            if (data.activeIter == iter || v->outDeg() == 0) data.residual = 0;
+            data.rank += data.acc;
+            data.residual += data.acc;
+            data.acc = 0;
+            if (v->outDeg() != 0 && std::abs(data.residual) > threshold_) {
+                data.activeIter = iter + 1;
+            }
+        }
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool converged) const {
+        // Converge when no vertex is active in the next iteration.
+        uint64_t activeCount = 0;
+        uint64_t messageCount = 0;
+        for (auto& graph : graphs) {
+            for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+                const auto& v = vertexIter->second;
+                if (v->data().activeIter == iter + 1) {
+                    activeCount++;
+                    messageCount += v->outDeg().cnt();
+                }
+            }
+        }
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(activeCount, messageCount),
+                GraphGASLite::TupleCombiner<GraphGASLite::SumCombiner<uint64_t>, GraphGASLite::SumCombiner<uint64_t>>());
+        activeCount = std::get<0>(ret);
+        if (this->verbose() && workerId == 0) {
+            info("\tIteration %lu: %lu active vertices, %lu messages", iter.cnt(), activeCount, std::get<1>(ret));
+        }
+        return converged && activeCount == 0;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        // Start from the teleport value, which is all propagated in the first iteration.
+        for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+            auto& data = vertexIter->second->data();
+            data.rank = 1 - beta_;
+            data.residual = 1 - beta_;
+            data.acc = 0;
+            data.activeIter = 0;
+        }
+    }
+
+protected:
+    DeltaPageRankEdgeCentricAlgoKernel(const string& name, const double beta, const double tolerance)
+        : BaseKernelType(name),
+          beta_(beta), tolerance_(tolerance),
+          threshold_(tolerance * (1 - beta) * (1 - beta))
+    {
+        // Nothing else to do.
+    }
+
+private:
+    const double beta_;
+    const double tolerance_;
+    const double threshold_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_DELTAPR_DELTAPR_H_
@@ -0,0 +1,300 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_DELTASSSP_DELTASSSP_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_DELTASSSP_DELTASSSP_H_
+
+#include <atomic>
+#include <map>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+#define INF(type) std::numeric_limits<type>::max()
+#define INV_VID -1uL
+
+/*
+ * Delta-stepping SSSP.
+ *
+ * Vertices are grouped into buckets of width delta by their tentative
+ * distances. Each iteration only relaxes the improved vertices in the lowest
+ * non-empty bucket, so vertices far from the settled frontier do not
+ * repeatedly propagate distances that will later be improved.
+ *
+ * Within an iteration, local vertices improved into the current bucket, i.e.,
+ * through light edges, are relaxed again right away, so each tile reaches a
+ * local fixpoint of the bucket, and only improvements crossing tiles take
+ * another iteration. Improvements to the same remote vertex are combined in
+ * its mirror vertex. Each tile keeps its own bucket lists, so finding the
+ * next bucket does not scan all vertices.
+ */
+
+/*
+ * Graph types definitions.
+ */
+template<typename EdgeWeightType = uint32_t>
+struct DeltaSSSPData {
+    EdgeWeightType distance;
+    GraphGASLite::VertexIdx predecessor;
+
+    DeltaSSSPData(const GraphGASLite::VertexIdx&)
+        : distance(INF(EdgeWeightType)), predecessor(INV_VID)
+    {
+        // Nothing else to do.
+    }
+};
+
+template<typename EdgeWeightType = uint32_t>
+struct DeltaSSSPUpdate {
+    EdgeWeightType distance;
+    GraphGASLite::VertexIdx predecessor;
+
+    DeltaSSSPUpdate(const EdgeWeightType distance_ = INF(EdgeWeightType), const GraphGASLite::VertexIdx& predecessor_ = INV_VID)
+        : distance(distance_), predecessor(predecessor_)
+    {
+        // Nothing else to do.
+    }
+
+    DeltaSSSPUpdate& operator+=(const DeltaSSSPUpdate& update) {
+        // Min of distance.
+        if (distance > update.distance) {
+            distance = update.distance;
+            predecessor = update.predecessor;
+        }
+        return *this;
+    }
+};
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class DeltaSSSPEdgeCentricAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<DeltaSSSPEdgeCentricAlgoKernel> instanceNew(const string& name,
+            const GraphGASLite::VertexIdx& src, const uint64_t delta) {
+        return Ptr<DeltaSSSPEdgeCentricAlgoKernel>(new DeltaSSSPEdgeCentricAlgoKernel(name, src, delta));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphTileType::UpdateType UpdateType;
+    typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+        // Weights of the out-edges, in the order of the CSC view.
+        std::vector<EdgeWeightType> outEdgeWeights;
+
+        std::vector<EdgeWeightType> distance;
+        std::vector<GraphGASLite::VertexIdx::Type> predecessor;
+        // Distance has improved but not yet been propagated.
+        std::vector<bool> pending;
+
+        // Pending vertices by bucket. An entry is stale if the vertex has
+        // been relaxed or moved to a lower bucket.
+        std::map< uint64_t, std::vector<uint32_t> > buckets;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), outEdgeWeights(graph->edgeCount()),
+              distance(csc.vertexCount(), INF(EdgeWeightType)), predecessor(csc.vertexCount(), INV_VID),
+              pending(csc.vertexCount(), false)
+        {
+            // Out-edges of each vertex are in the order of the tile edges.
+            std::vector<size_t> pos(csc.outEdgeOffsets().begin(), csc.outEdgeOffsets().end() - 1);
+            for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
+                outEdgeWeights[pos[csc.vertexIdx(edgeIter->srcId())]++] = edgeIter->weight();
+            }
+        }
+
+        /**
+         * Lower the distance of local vertex \c idx, and return its bucket if
+         * improved, or INF otherwise.
+         */
+        uint64_t improve(const uint32_t idx, const EdgeWeightType dist, const GraphGASLite::VertexIdx::Type pred,
+                const uint64_t delta) {
+            if (distance[idx] <= dist) return INF(uint64_t);
+            distance[idx] = dist;
+            predecessor[idx] = pred;
+            pending[idx] = true;
+            const uint64_t b = dist / delta;
+            buckets[b].push_back(idx);
+            return b;
+        }
+
+        /**
+         * Lowest bucket with pending vertices, or INF if none.
+         */
+        uint64_t lowBucket(const uint64_t delta) {
+            while (!buckets.empty()) {
+                auto it = buckets.begin();
+                for (const auto idx : it->second) {
+                    if (pending[idx] && distance[idx] / delta == it->first) return it->first;
+                }
+                buckets.erase(it);
+            }
+            return INF(uint64_t);
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+        const auto& csc = state.csc;
+        const auto vertexCount = csc.vertexCount();
+        const auto bucket = bucket_.load(std::memory_order_relaxed);
+
+        cs.keyValProdDelAll(tid);
+
+        auto it = state.buckets.find(bucket);
+        if (it != state.buckets.end()) {
+            // Vertices improved into the current bucket are appended and
+            // relaxed within the same iteration.
+            std::vector<uint32_t> work;
+            work.swap(it->second);
+            state.buckets.erase(it);
+            for (size_t pos = 0; pos < work.size(); pos++) {
+                const auto idx = work[pos];
+                if (!state.pending[idx] || state.distance[idx] / delta_ != bucket) continue;
+                state.pending[idx] = false;
+                const auto dist = state.distance[idx];
+                const GraphGASLite::VertexIdx::Type vid = csc.vertexAt(idx)->vid();
+                for (auto e = csc.outEdgeOffsets()[idx]; e < csc.outEdgeOffsets()[idx + 1]; e++) {
+                    const auto t = csc.outEdgeTargets()[e];
+                    const EdgeWeightType d = dist + state.outEdgeWeights[e];
+                    if (t < vertexCount) {
+                        if (state.improve(t, d, vid, delta_) == bucket) work.push_back(t);
+                    } else {
+                        // Improvements to the same remote vertex are combined.
+                        graph->mirrorVertexAt(t - vertexCount).updateNew(UpdateType(d, vid));
+                    }
+                }
+            }
+            // Entries appended to the current bucket have all been relaxed.
+            state.buckets.erase(bucket);
+        }
+
+        // Only visit the mirror vertices touched in this iteration.
+        for (const auto idx : graph->mirrorVertexDirtyList()) {
+            const auto& mv = graph->mirrorVertexAt(idx);
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), mv.accUpdate());
+        }
+        graph->mirrorVertexDirtyDelAll();
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        bool converged = true;
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    const auto& update = u.val();
+                    if (state.improve(state.csc.vertexIdx(u.key()), update.distance, update.predecessor, delta_)
+                            != INF(uint64_t)) {
+                        converged = false;
+                    }
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+
+        return converged;
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool) const {
+        // Find the lowest non-empty bucket among all tiles.
+        uint64_t bucket = INF(uint64_t);
+        for (auto& graph : graphs) {
+            bucket = std::min(bucket, states_[graph->tid()]->lowBucket(delta_));
+        }
+        bucket = cs.template barrierReduce<GraphGASLite::MinCombiner<uint64_t>>(workerId, bucket);
+
+        // All buckets are empty.
+        if (bucket == INF(uint64_t)) return true;
+
+        if (this->verbose() && workerId == 0) {
+            info("\tIteration %lu: bucket %lu", iter.cnt(), bucket);
+        }
+
+        // Relax the vertices in the bucket in the next iteration.
+        bucket_.store(bucket, std::memory_order_relaxed);
+        return false;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+        // Set source vertex, which is alone in the first bucket.
+        if (graph->vertex(src_) != nullptr) {
+            state->improve(state->csc.vertexIdx(src_), 0, INV_VID, delta_);
+        }
+        states_.stateIs(graph->tid(), state);
+        bucket_.store(0, std::memory_order_relaxed);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        const auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            auto& data = state->csc.vertexAt(idx)->data();
+            data.distance = state->distance[idx];
+            data.predecessor = state->predecessor[idx];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    DeltaSSSPEdgeCentricAlgoKernel(const string& name, const GraphGASLite::VertexIdx& src, const uint64_t delta)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name),
+          src_(src), delta_(delta), bucket_(0)
+    {
+        if (delta_ == 0) {
+            throw InvalidArgumentException("delta");
+        }
+    }
+
+private:
+    const GraphGASLite::VertexIdx src_;
+    const uint64_t delta_;
+
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+    // Bucket to relax in this iteration. Every worker stores the same reduced
+    // value, which the next iteration reads for any tile it sends.
+    mutable std::atomic<uint64_t> bucket_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_DELTASSSP_DELTASSSP_H_
@@ -0,0 +1,41 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include "harness.h"
+#include "deltasssp.h"
+
+typedef GraphGASLite::GraphTile<DeltaSSSPData<>, DeltaSSSPUpdate<>> Graph;
+typedef DeltaSSSPEdgeCentricAlgoKernel<Graph> Kernel;
+
+const char appName[] = "deltasssp";
+
+class AppArgs : public GenericArgs<uint64_t, uint64_t> {
+public:
+    AppArgs() : GenericArgs<uint64_t, uint64_t>() {
+        std::get<0>(argTuple_) = srcDefault;
+        std::get<1>(argTuple_) = deltaDefault;
+    };
+
+    const ArgInfo* argInfoList() const {
+        static const ArgInfo list[] = {
+            {"", "[src]", "Source vertex index (default " + std::to_string(srcDefault) + ")."},
+            {"", "[delta]", "Distance bucket width (default " + std::to_string(deltaDefault) + ")."},
+        };
+        return list;
+    }
+
+    bool isValid() const {
+        return arg<1>() > 0;
+    }
+
+private:
+    static constexpr uint64_t srcDefault = 0;
+    static constexpr uint64_t deltaDefault = 16;
+};
+
+#define VDATA(vd) \
+    std::to_string(vd.distance) + \
+    "\t<- " + \
+    (vd.predecessor == INV_VID ? "none" : std::to_string(vd.predecessor))
+
+#endif // KERNEL_HARNESS_H_
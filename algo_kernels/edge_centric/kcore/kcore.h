@@ -0,0 +1,306 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_KCORE_KCORE_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_KCORE_KCORE_H_
+
+#include <atomic>
+#include <limits>
+#include <tuple>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+#define INF_DEGREE std::numeric_limits<uint64_t>::max()
+
+/*
+ * k-core decomposition by bucketed peeling, on undirected graphs.
+ *
+ * At level k, the remaining vertices with residual degree at most k are
+ * removed with core number k, which decrements the residual degrees of their
+ * neighbors, and may remove more vertices at the same level. When none is
+ * left at level k, the level jumps to the lowest residual degree among the
+ * remaining vertices.
+ *
+ * Each iteration only scans the out-edges of the vertices removed since the
+ * last iteration, i.e., the frontier, and removes local vertices transitively
+ * within the tile. Decrements to the same remote vertex are
+ * combined in its mirror vertex. Remaining vertices are kept in buckets by
+ * residual degree, so finding the next level does not scan all vertices.
+ *
+ * Residual degrees start from the number of distinct neighbors, so parallel
+ * edges are counted once and self loops are not counted.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct KCoreData {
+    uint64_t core;
+
+    KCoreData(const GraphGASLite::VertexIdx&)
+        : core(0)
+    {
+        // Nothing else to do.
+    }
+};
+
+// Degree decrement.
+typedef uint64_t KCoreUpdate;
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class KCoreAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<KCoreAlgoKernel> instanceNew(const string& name) {
+        return Ptr<KCoreAlgoKernel>(new KCoreAlgoKernel(name));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+        // Distinct neighbors of each local vertex, excluding self loops, as
+        // targets of the CSC view in [adjOffsets[idx], adjOffsets[idx+1]).
+        std::vector<size_t> adjOffsets;
+        std::vector<uint32_t> adjTargets;
+
+        std::vector<uint64_t> residual;
+        std::vector<uint64_t> core;
+        std::vector<bool> removed;
+
+        // Removed but whose edges are not yet scanned.
+        std::vector<uint32_t> frontier;
+        std::vector<uint32_t> nextFrontier;
+
+        // Remaining vertices by residual degree. An entry is stale if the
+        // vertex has been removed or moved to a lower bucket.
+        std::vector< std::vector<uint32_t> > buckets;
+        // No remaining vertex is in lower buckets.
+        uint64_t lowBucket;
+
+        uint64_t level;
+        uint64_t remaining;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), residual(csc.vertexCount()), core(csc.vertexCount(), 0), removed(csc.vertexCount(), false),
+              lowBucket(0), level(0), remaining(csc.vertexCount())
+        {
+            // Out-edges are in the order of the tile edges, i.e., sorted by
+            // destination, so parallel edges are adjacent.
+            const auto& offsets = csc.outEdgeOffsets();
+            const auto& targets = csc.outEdgeTargets();
+            adjOffsets.assign(csc.vertexCount() + 1, 0);
+            adjTargets.reserve(targets.size());
+            for (uint32_t idx = 0; idx < csc.vertexCount(); idx++) {
+                for (auto e = offsets[idx]; e < offsets[idx + 1]; e++) {
+                    const auto t = targets[e];
+                    if (t == idx || (adjTargets.size() > adjOffsets[idx] && adjTargets.back() == t)) continue;
+                    adjTargets.push_back(t);
+                }
+                adjOffsets[idx + 1] = adjTargets.size();
+                residual[idx] = adjOffsets[idx + 1] - adjOffsets[idx];
+                bucketIs(idx);
+            }
+        }
+
+        void bucketIs(const uint32_t idx) {
+            const auto r = residual[idx];
+            if (buckets.size() <= r) buckets.resize(r + 1);
+            buckets[r].push_back(idx);
+            lowBucket = std::min(lowBucket, r);
+        }
+
+        /**
+         * Decrease the residual degree of a remaining vertex by \c dec. If
+         * removed, append it to \c list.
+         */
+        void decrease(const uint32_t idx, const uint64_t dec, std::vector<uint32_t>& list) {
+            if (removed[idx]) return;
+            residual[idx] -= std::min(residual[idx], dec);
+            if (residual[idx] <= level) {
+                remove(idx, list);
+            } else {
+                bucketIs(idx);
+            }
+        }
+
+        void remove(const uint32_t idx, std::vector<uint32_t>& list) {
+            removed[idx] = true;
+            core[idx] = level;
+            remaining--;
+            list.push_back(idx);
+        }
+
+        /**
+         * Lowest residual degree of the remaining vertices.
+         */
+        uint64_t lowResidual() {
+            if (remaining == 0) return INF_DEGREE;
+            for (; lowBucket < buckets.size(); lowBucket++) {
+                auto& b = buckets[lowBucket];
+                while (!b.empty() && (removed[b.back()] || residual[b.back()] != lowBucket)) b.pop_back();
+                if (!b.empty()) return lowBucket;
+            }
+            return INF_DEGREE;
+        }
+
+        /**
+         * Start a new level, and remove the vertices at this level.
+         */
+        void levelIs(const uint64_t l) {
+            level = l;
+            if (lowResidual() != level) return;
+            for (const auto idx : buckets[level]) {
+                if (!removed[idx] && residual[idx] == level) remove(idx, frontier);
+            }
+            std::vector<uint32_t>().swap(buckets[level]);
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        // A new level was started in the last iteration.
+        const auto level = level_.load(std::memory_order_relaxed);
+        if (state.level != level) state.levelIs(level);
+
+        cs.keyValProdDelAll(tid);
+
+        const auto vertexCount = state.csc.vertexCount();
+        // Local removals are appended to and scanned within the same frontier,
+        // so only removals crossing tiles take another iteration.
+        for (size_t pos = 0; pos < state.frontier.size(); pos++) {
+            const auto idx = state.frontier[pos];
+            for (auto e = state.adjOffsets[idx]; e < state.adjOffsets[idx + 1]; e++) {
+                const auto t = state.adjTargets[e];
+                if (t < vertexCount) {
+                    state.decrease(t, 1, state.frontier);
+                } else {
+                    // Decrements to the same remote vertex are accumulated.
+                    graph->mirrorVertexAt(t - vertexCount).updateNew(1);
+                }
+            }
+        }
+        state.frontier.clear();
+
+        // Only visit the mirror vertices touched in this iteration.
+        for (const auto idx : graph->mirrorVertexDirtyList()) {
+            const auto& mv = graph->mirrorVertexAt(idx);
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), mv.accUpdate());
+        }
+        graph->mirrorVertexDirtyDelAll();
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    state.decrease(state.csc.vertexIdx(u.key()), u.val(), state.nextFrontier);
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+
+        state.frontier.swap(state.nextFrontier);
+        return state.frontier.empty();
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool converged) const {
+        uint64_t lowResidual = INF_DEGREE;
+        if (converged) {
+            for (auto& graph : graphs) {
+                lowResidual = std::min(lowResidual, states_[graph->tid()]->lowResidual());
+            }
+        }
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(converged, lowResidual),
+                GraphGASLite::TupleCombiner<GraphGASLite::ANDCombiner, GraphGASLite::MinCombiner<uint64_t>>());
+
+        // Continue peeling at the current level.
+        if (!std::get<0>(ret)) return false;
+
+        lowResidual = std::get<1>(ret);
+        // All vertices have been removed.
+        if (lowResidual == INF_DEGREE) return true;
+
+        if (this->verbose() && workerId == 0) {
+            info("\tIteration %lu: level %lu", iter.cnt(), lowResidual);
+        }
+
+        // Tiles start the level when they are next sent.
+        level_.store(lowResidual, std::memory_order_relaxed);
+        return false;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+        // Isolated vertices.
+        state->levelIs(0);
+        states_.stateIs(graph->tid(), state);
+        level_.store(0, std::memory_order_relaxed);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            state->csc.vertexAt(idx)->data().core = state->core[idx];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    explicit KCoreAlgoKernel(const string& name)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name),
+          level_(0)
+    {
+        // Nothing else to do.
+    }
+
+private:
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+    // Current level, same for all workers.
+    mutable std::atomic<uint64_t> level_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_KCORE_KCORE_H_
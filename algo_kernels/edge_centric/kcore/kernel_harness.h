@@ -0,0 +1,24 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include "harness.h"
+#include "kcore.h"
+
+typedef GraphGASLite::GraphTile<KCoreData, KCoreUpdate> Graph;
+typedef KCoreAlgoKernel<Graph> Kernel;
+
+const char appName[] = "kcore";
+
+class AppArgs : public GenericArgs<> {
+public:
+    AppArgs() : GenericArgs<>() { };
+
+    const ArgInfo* argInfoList() const {
+        // No app-specific arguments.
+        return nullptr;
+    }
+};
+
+#define VDATA(vd) vd.core
+
+#endif // KERNEL_HARNESS_H_
@@ -0,0 +1,372 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_LPA_LPA_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_LPA_LPA_H_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+#include <tuple>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+#define INV_LABEL std::numeric_limits<GraphGASLite::VertexIdx::Type>::max()
+
+/*
+ * Label propagation community detection, on undirected graphs.
+ *
+ * Each vertex starts with its own index as label, and adopts the most
+ * frequent label among its neighbors. It keeps its own label if that is one
+ * of the most frequent, otherwise the smallest one wins. Synchronous updates
+ * may oscillate, e.g., two vertices swapping labels, so in each iteration only
+ * a pseudo-random half of the vertices may switch, and the others wait.
+ *
+ * Each vertex keeps the exact label counts of its neighbors. Only the vertices
+ * whose labels changed in the last iteration scatter, as count changes of
+ * their old and new labels, and only the vertices whose counts changed, or
+ * which are waiting to switch, decide again. So stable vertices neither
+ * scatter nor decide.
+ *
+ * Count changes to a remote vertex are combined in its mirror vertex as a
+ * sparse histogram of at most \c K labels. When full, the entry of the
+ * smallest magnitude is evicted and sent alone, so the combined update stays
+ * exact with a fixed size.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct LPAData {
+    GraphGASLite::VertexIdx::Type label;
+
+    LPAData(const GraphGASLite::VertexIdx& vid)
+        : label(vid)
+    {
+        // Nothing else to do.
+    }
+};
+
+/**
+ * Sparse histogram of label count changes, with at most \c K labels.
+ *
+ * Fixed size and trivially copyable, to be sent as a key-value pair value and
+ * accumulated in a mirror vertex.
+ */
+template<size_t K = 8>
+struct LabelHistogram {
+    struct Entry {
+        GraphGASLite::VertexIdx::Type label;
+        int64_t count;
+    };
+
+    std::array<Entry, K> entries;
+    uint32_t size;
+
+    LabelHistogram() : size(0) { }
+
+    LabelHistogram(const GraphGASLite::VertexIdx::Type label, const int64_t count)
+        : size(1)
+    {
+        entries[0] = Entry{label, count};
+    }
+
+    bool full() const { return size == K; }
+
+    bool contains(const GraphGASLite::VertexIdx::Type label) const {
+        for (uint32_t i = 0; i < size; i++) {
+            if (entries[i].label == label) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Entry of the smallest count magnitude.
+     */
+    const Entry& minEntry() const {
+        uint32_t m = 0;
+        for (uint32_t i = 1; i < size; i++) {
+            if (std::abs(entries[i].count) < std::abs(entries[m].count)) m = i;
+        }
+        return entries[m];
+    }
+
+    /**
+     * Merge the counts. The merged labels must fit, see full() and
+     * contains(). Cancelled labels are removed.
+     */
+    LabelHistogram& operator+=(const LabelHistogram& hist) {
+        for (uint32_t j = 0; j < hist.size; j++) {
+            const auto& e = hist.entries[j];
+            uint32_t i = 0;
+            while (i < size && entries[i].label != e.label) i++;
+            if (i == size) {
+                assert(size < K);
+                entries[size++] = e;
+            } else if ((entries[i].count += e.count) == 0) {
+                entries[i] = entries[--size];
+            }
+        }
+        return *this;
+    }
+};
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class LPAAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<LPAAlgoKernel> instanceNew(const string& name) {
+        return Ptr<LPAAlgoKernel>(new LPAAlgoKernel(name));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphTileType::UpdateType UpdateType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+    typedef GraphGASLite::VertexIdx::Type LabelType;
+    typedef typename UpdateType::Entry LabelCount;
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+
+        std::vector<LabelType> label;
+        // Label counts of the neighbors, sorted by label.
+        std::vector< std::vector<LabelCount> > counts;
+
+        // Label changed in the last iteration, with the old label.
+        std::vector< std::pair<uint32_t, LabelType> > changed;
+        // Counts changed in this iteration, or waiting to switch, to decide
+        // again.
+        std::vector<uint32_t> touched;
+        std::vector<bool> isTouched;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), label(csc.vertexCount()), counts(csc.vertexCount()), isTouched(csc.vertexCount(), false)
+        {
+            // Initial labels are sent as changed from none.
+            changed.reserve(csc.vertexCount());
+            for (uint32_t idx = 0; idx < csc.vertexCount(); idx++) {
+                label[idx] = csc.vertexAt(idx)->vid();
+                changed.emplace_back(idx, INV_LABEL);
+            }
+        }
+
+        void countAdd(const uint32_t idx, const LabelType l, const int64_t count) {
+            auto& c = counts[idx];
+            auto it = std::lower_bound(c.begin(), c.end(), l,
+                    [](const LabelCount& e, const LabelType k) { return e.label < k; });
+            if (it == c.end() || it->label != l) {
+                c.insert(it, LabelCount{l, count});
+            } else if ((it->count += count) == 0) {
+                c.erase(it);
+            }
+            if (!isTouched[idx]) {
+                isTouched[idx] = true;
+                touched.push_back(idx);
+            }
+        }
+
+        /**
+         * Most frequent label of the neighbors.
+         */
+        LabelType decide(const uint32_t idx) const {
+            const auto own = label[idx];
+            int64_t maxCount = 0;
+            int64_t ownCount = 0;
+            for (const auto& e : counts[idx]) {
+                maxCount = std::max(maxCount, e.count);
+                if (e.label == own) ownCount = e.count;
+            }
+            if (ownCount == maxCount) return own;
+            // Sorted by label, so the first one is the smallest.
+            for (const auto& e : counts[idx]) {
+                if (e.count == maxCount) return e.label;
+            }
+            return own;
+        }
+
+        /**
+         * Whether vertex \c idx may switch its label in iteration \c iter.
+         */
+        bool mayChange(const uint32_t idx, const GraphGASLite::IterCount& iter) const {
+            uint64_t h = csc.vertexAt(idx)->vid() * 0x9e3779b97f4a7c15uL ^ iter.cnt();
+            // splitmix64 finalizer.
+            h ^= h >> 30;
+            h *= 0xbf58476d1ce4e5b9uL;
+            h ^= h >> 27;
+            h *= 0x94d049bb133111ebuL;
+            h ^= h >> 31;
+            return h & 0x1;
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        cs.keyValProdDelAll(tid);
+
+        const auto vertexCount = state.csc.vertexCount();
+        for (const auto& c : state.changed) {
+            const auto idx = c.first;
+            const auto oldLabel = c.second;
+            const auto newLabel = state.label[idx];
+            for (auto e = state.csc.outEdgeOffsets()[idx]; e < state.csc.outEdgeOffsets()[idx + 1]; e++) {
+                const auto t = state.csc.outEdgeTargets()[e];
+                if (t < vertexCount) {
+                    // Local destination, decides after all counts are received.
+                    state.countAdd(t, newLabel, 1);
+                    if (oldLabel != INV_LABEL) state.countAdd(t, oldLabel, -1);
+                } else {
+                    auto& mv = graph->mirrorVertexAt(t - vertexCount);
+                    mirrorCountAdd(cs, tid, mv, newLabel, 1);
+                    if (oldLabel != INV_LABEL) mirrorCountAdd(cs, tid, mv, oldLabel, -1);
+                }
+            }
+        }
+        state.changed.clear();
+
+        // Only visit the mirror vertices touched in this iteration.
+        for (const auto idx : graph->mirrorVertexDirtyList()) {
+            const auto& mv = graph->mirrorVertexAt(idx);
+            // All counts may have cancelled.
+            if (mv.accUpdate().size == 0) continue;
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), mv.accUpdate());
+        }
+        graph->mirrorVertexDirtyDelAll();
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount& iter) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    const auto idx = state.csc.vertexIdx(u.key());
+                    const auto& hist = u.val();
+                    for (uint32_t i = 0; i < hist.size; i++) {
+                        state.countAdd(idx, hist.entries[i].label, hist.entries[i].count);
+                    }
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+
+        // Only the vertices with changed counts decide.
+        size_t waiting = 0;
+        for (const auto idx : state.touched) {
+            const auto l = state.decide(idx);
+            if (l == state.label[idx]) {
+                state.isTouched[idx] = false;
+            } else if (state.mayChange(idx, iter)) {
+                state.isTouched[idx] = false;
+                state.changed.emplace_back(idx, state.label[idx]);
+                state.label[idx] = l;
+            } else {
+                // Decide again in the next iteration.
+                state.touched[waiting++] = idx;
+            }
+        }
+        state.touched.resize(waiting);
+
+        return state.changed.empty() && state.touched.empty();
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool) const {
+        uint64_t changedCount = 0;
+        uint64_t waitingCount = 0;
+        for (auto& graph : graphs) {
+            const auto& state = *states_[graph->tid()];
+            changedCount += state.changed.size();
+            waitingCount += state.touched.size();
+        }
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(changedCount, waitingCount),
+                GraphGASLite::TupleCombiner<GraphGASLite::SumCombiner<uint64_t>, GraphGASLite::SumCombiner<uint64_t>>());
+        std::tie(changedCount, waitingCount) = ret;
+        if (this->verbose() && workerId == 0) {
+            info("\tIteration %lu: %lu changed vertices, %lu waiting", iter.cnt(), changedCount, waitingCount);
+        }
+        return changedCount == 0 && waitingCount == 0;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+        states_.stateIs(graph->tid(), state);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            state->csc.vertexAt(idx)->data().label = state->label[idx];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    explicit LPAAlgoKernel(const string& name)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name)
+    {
+        // Nothing else to do.
+    }
+
+private:
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+
+    /**
+     * Combine a label count change in mirror vertex \c mv. If its histogram
+     * is full, first evict the entry of the smallest magnitude and send it
+     * alone.
+     */
+    void mirrorCountAdd(CommSyncType& cs, const uint32_t tid, typename GraphTileType::MirrorVertexType& mv,
+            const LabelType l, const int64_t count) const {
+        const auto& acc = mv.accUpdate();
+        if (mv.hasUpdate() && acc.full() && !acc.contains(l)) {
+            const auto evicted = acc.minEntry();
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), UpdateType(evicted.label, evicted.count));
+            // Cancel it in the mirror vertex.
+            mv.updateNew(UpdateType(evicted.label, -evicted.count));
+        }
+        mv.updateNew(UpdateType(l, count));
+    }
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_LPA_LPA_H_
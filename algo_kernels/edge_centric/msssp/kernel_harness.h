@@ -0,0 +1,72 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include "harness.h"
+#include "msssp.h"
+
+typedef GraphGASLite::GraphTile<MSSSPData<>, MSSSPUpdate<>> Graph;
+typedef MSSSPEdgeCentricAlgoKernel<Graph> Kernel;
+
+const char appName[] = "msssp";
+
+class AppArgs : public GenericArgs<string> {
+public:
+    AppArgs() : GenericArgs<string>() {
+        std::get<0>(argTuple_) = srcsDefault;
+    };
+
+    const ArgInfo* argInfoList() const {
+        static const ArgInfo list[] = {
+            {"", "[srcs]", "Comma-separated source vertex indices, at most "
+                + std::to_string(Kernel::width) + " (default " + srcsDefault + ")."},
+        };
+        return list;
+    }
+
+    bool isValid() const {
+        Kernel::SourceList srcs;
+        return sourceList(srcs) && !srcs.empty() && srcs.size() <= Kernel::width;
+    }
+
+    template<typename KernelType>
+    Ptr<KernelType> algoKernel(const string& kernelName) {
+        Kernel::SourceList srcs;
+        sourceList(srcs);
+        return KernelType::instanceNew(kernelName, srcs);
+    }
+
+private:
+    static const string srcsDefault;
+
+    bool sourceList(Kernel::SourceList& srcs) const {
+        std::stringstream ss(arg<0>());
+        string item;
+        while (std::getline(ss, item, ',')) {
+            uint64_t src;
+            std::stringstream iss(item);
+            if (!(iss >> src)) return false;
+            srcs.push_back(src);
+        }
+        return true;
+    }
+};
+
+const string AppArgs::srcsDefault = "0";
+
+/*
+ * Output reached queries as <query>:<distance>.
+ */
+template<typename Data>
+string msssp_vdata(const Data& vd) {
+    string str;
+    for (size_t q = 0; q < vd.distance.size(); q++) {
+        if (vd.distance[q] == INF(typename decltype(vd.distance)::value_type)) continue;
+        if (!str.empty()) str += " ";
+        str += std::to_string(q) + ":" + std::to_string(vd.distance[q]);
+    }
+    return str.empty() ? "none" : str;
+}
+
+#define VDATA(vd) msssp_vdata(vd)
+
+#endif // KERNEL_HARNESS_H_
@@ -0,0 +1,154 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_MSSSP_MSSSP_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_MSSSP_MSSSP_H_
+
+#include <array>
+#include <vector>
+#include "graph.h"
+#include "algo_kernel.h"
+
+#define INF(type) std::numeric_limits<type>::max()
+
+/*
+ * Batched multi-source SSSP. Each vertex carries the distances from a batch
+ * of up to \c Width sources, so one pass over the edges advances all queries.
+ */
+
+/*
+ * Graph types definitions.
+ */
+template<typename EdgeWeightType = uint32_t, size_t Width = 64>
+struct MSSSPData {
+    static_assert(Width <= 64, "MSSSPData: batch width must fit in the active mask.");
+
+    std::array<EdgeWeightType, Width> distance;
+    // Bit q is set if the distance from query q changed in iteration activeIter - 1.
+    uint64_t activeMask;
+    GraphGASLite::IterCount activeIter;
+
+    MSSSPData(const GraphGASLite::VertexIdx&)
+        : activeMask(0), activeIter(-1)
+    {
+        distance.fill(INF(EdgeWeightType));
+    }
+};
+
+template<typename EdgeWeightType = uint32_t, size_t Width = 64>
+struct MSSSPUpdate {
+    std::array<EdgeWeightType, Width> distance;
+
+    MSSSPUpdate() {
+        distance.fill(INF(EdgeWeightType));
+    }
+
+    MSSSPUpdate& operator+=(const MSSSPUpdate& update) {
+        // Element-wise min of distance, branch-free to vectorize.
+        for (size_t q = 0; q < Width; q++) {
+            distance[q] = std::min(distance[q], update.distance[q]);
+        }
+        return *this;
+    }
+};
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class MSSSPEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, MSSSPEdgeCentricAlgoKernel<GraphTileType>> {
+    typedef GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, MSSSPEdgeCentricAlgoKernel<GraphTileType>> BaseKernelType;
+    friend BaseKernelType;
+
+public:
+    typedef std::vector<GraphGASLite::VertexIdx> SourceList;
+
+    // Batch width, i.e., the maximum number of sources.
+    static constexpr size_t width = std::tuple_size<decltype(GraphTileType::UpdateType::distance)>::value;
+
+    static Ptr<MSSSPEdgeCentricAlgoKernel> instanceNew(const string& name,
+            const SourceList& srcs) {
+        return Ptr<MSSSPEdgeCentricAlgoKernel>(new MSSSPEdgeCentricAlgoKernel(name, srcs));
+    }
+
+    bool asyncAllowed() const { return true; }
+
+protected:
+    typedef typename GraphTileType::UpdateType UpdateType;
+    typedef typename GraphTileType::VertexType VertexType;
+    typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
+
+    std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
+        auto& data = src->data();
+        std::pair<UpdateType, bool> ret;
+        // In asynchronous mode, also scatter vertices updated earlier in this iteration.
+        ret.second = (data.activeIter == iter || (this->async() && data.activeIter == iter + 1))
+            && data.activeMask != 0;
+        if (ret.second) {
+            // Only relax the queries whose distance changed in the last iteration.
+            for (size_t q = 0; q < width; q++) {
+                if (data.activeMask & (1uLL << q)) {
+                    ret.first.distance[q] = data.distance[q] + weight;
+                }
+            }
+        }
+        return ret;
+    }
+
+    bool gather(const GraphGASLite::IterCount& iter, Ptr<VertexType>& dst, const UpdateType& update) const {
+        auto& data = dst->data();
+        // Start a new active mask for the next iteration. In asynchronous mode,
+        // a vertex active in this iteration may not have scattered yet, so keep
+        // its lanes.
+        if (data.activeIter != iter + 1 && !(this->async() && data.activeIter == iter)) {
+            data.activeMask = 0;
+        }
+        uint64_t changed = 0;
+        for (size_t q = 0; q < width; q++) {
+            if (data.distance[q] > update.distance[q]) {
+                data.distance[q] = update.distance[q];
+                changed |= (1uLL << q);
+            }
+        }
+        if (changed == 0) return true;
+        data.activeMask |= changed;
+        data.activeIter = iter + 1;
+        // Not converged.
+        return false;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        // Reset results of the last batch.
+        for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+            auto& data = vertexIter->second->data();
+            data.distance.fill(INF(EdgeWeightType));
+            data.activeMask = 0;
+            data.activeIter = -1;
+        }
+
+        // Set source vertices.
+        for (size_t q = 0; q < srcs_.size(); q++) {
+            auto vsrc = graph->vertex(srcs_[q]);
+            // Source vertex does not exist.
+            if (vsrc == nullptr) continue;
+            auto& data = vsrc->data();
+            data.distance[q] = 0;
+            data.activeMask |= (1uLL << q);
+            data.activeIter = 0;
+        }
+    }
+
+protected:
+    MSSSPEdgeCentricAlgoKernel(const string& name, const SourceList& srcs)
+        : BaseKernelType(name),
+          srcs_(srcs)
+    {
+        if (srcs_.size() > width) {
+            throw RangeException("Number of sources " + std::to_string(srcs_.size())
+                    + " exceeds batch width " + std::to_string(width) + ".");
+        }
+    }
+
+private:
+    const SourceList srcs_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_MSSSP_MSSSP_H_
@@ -9,17 +9,20 @@ typedef PageRankEdgeCentricAlgoKernel<Graph> Kernel;
 
 const char appName[] = "pagerank";
 
-class AppArgs : public GenericArgs<double, double> {
+class AppArgs : public GenericArgs<double, double, double> {
 public:
-    AppArgs() : GenericArgs<double, double>() {
+    AppArgs() : GenericArgs<double, double, double>() {
         std::get<0>(argTuple_) = betaDefault;
         std::get<1>(argTuple_) = toleranceDefault;
+        std::get<2>(argTuple_) = l1ToleranceDefault;
     };
 
     const ArgInfo* argInfoList() const {
         static const ArgInfo list[] = {
             {"", "[beta]", "Damping factor (default " + std::to_string(betaDefault) + "). Should be between 0 and 1."},
             {"", "[tolerance]", "Error tolerance (default " + std::to_string(toleranceDefault) + ")."},
+            {"", "[l1Tolerance]", "Global L1 norm tolerance of rank changes (default "
+                + std::to_string(l1ToleranceDefault) + " means never)."},
         };
         return list;
     }
@@ -32,6 +35,7 @@ public:
 private:
     static constexpr double betaDefault = 0.85;
     static constexpr double toleranceDefault = 1e-4;
+    static constexpr double l1ToleranceDefault = 0;
 };
 
 #define VDATA(vd) vd.rank
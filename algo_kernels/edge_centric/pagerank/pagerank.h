@@ -11,9 +11,10 @@ struct PageRankData {
     GraphGASLite::DegreeCount collected;
     double sum;
     double rank;
+    double delta;   // rank change in the last iteration
 
     PageRankData(const GraphGASLite::VertexIdx&)
-        : collected(0), sum(0), rank(0)
+        : collected(0), sum(0), rank(0), delta(0)
     {
         // Nothing else to do.
     }
@@ -41,17 +42,22 @@ struct PageRankUpdate {
  * Algorithm kernel definition.
  */
 template<typename GraphTileType>
-class PageRankEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<GraphTileType> {
+class PageRankEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, PageRankEdgeCentricAlgoKernel<GraphTileType>> {
+    typedef GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, PageRankEdgeCentricAlgoKernel<GraphTileType>> BaseKernelType;
+    friend BaseKernelType;
+
 public:
     static Ptr<PageRankEdgeCentricAlgoKernel> instanceNew(const string& name,
-            const double beta, const double tolerance) {
-        return Ptr<PageRankEdgeCentricAlgoKernel>(new PageRankEdgeCentricAlgoKernel(name, beta, tolerance));
+            const double beta, const double tolerance, const double l1Tolerance) {
+        return Ptr<PageRankEdgeCentricAlgoKernel>(new PageRankEdgeCentricAlgoKernel(name, beta, tolerance, l1Tolerance));
     }
 
 protected:
     typedef typename GraphTileType::UpdateType UpdateType;
     typedef typename GraphTileType::VertexType VertexType;
     typedef typename GraphTileType::EdgeType::WeightType EdgeWeightType;
+    typedef typename BaseKernelType::CommSyncType CommSyncType;
+    typedef typename BaseKernelType::GraphTileList GraphTileList;
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount&, Ptr<VertexType>& src, EdgeWeightType&) const {
         auto& data = src->data();
@@ -70,6 +76,7 @@ protected:
         if (data.collected == dst->inDeg()) {
             double newRank = beta_ * data.sum + (1 - beta_);
             bool converge = (std::abs(newRank - data.rank) <= tolerance_);
+            data.delta = newRank - data.rank;
             data.rank = newRank;
             data.sum = 0;
             data.collected = 0;
@@ -79,6 +86,24 @@ protected:
         return true;
     }
 
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount&, const bool converged) const {
+        if (l1Tolerance_ <= 0) {
+            return cs.barrierAND(workerId, converged);
+        }
+
+        // Also converge if the global L1 norm of rank changes is small enough.
+        double delta = 0;
+        for (auto& graph : graphs) {
+            for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+                delta += std::abs(vertexIter->second->data().delta);
+            }
+        }
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(converged, delta),
+                GraphGASLite::TupleCombiner<GraphGASLite::ANDCombiner, GraphGASLite::SumCombiner<double>>());
+        return std::get<0>(ret) || std::get<1>(ret) <= l1Tolerance_;
+    }
+
     void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
         for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
             auto& v = vertexIter->second;
@@ -98,9 +123,10 @@ protected:
     }
 
 protected:
-    PageRankEdgeCentricAlgoKernel(const string& name, const double beta, const double tolerance)
-        : GraphGASLite::EdgeCentricAlgoKernel<GraphTileType>(name),
-          beta_(beta), tolerance_(tolerance)
+    PageRankEdgeCentricAlgoKernel(const string& name, const double beta, const double tolerance,
+            const double l1Tolerance)
+        : BaseKernelType(name),
+          beta_(beta), tolerance_(tolerance), l1Tolerance_(l1Tolerance)
     {
         // Nothing else to do.
     }
@@ -108,6 +134,7 @@ protected:
 private:
     const double beta_;
     const double tolerance_;
+    const double l1Tolerance_;
 };
 
 #endif // ALGO_KERNELS_EDGE_CENTRIC_PAGERANK_PAGERANK_H_
@@ -0,0 +1,106 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include <algorithm>
+#include <fstream>
+#include "harness.h"
+#include "ppr.h"
+
+constexpr size_t batchWidth = 16;
+
+typedef GraphGASLite::GraphTile<PPRData<batchWidth>, PPRUpdate<batchWidth>> Graph;
+typedef PPRAlgoKernel<Graph> Kernel;
+
+const char appName[] = "ppr";
+
+class AppArgs : public GenericArgs<string, uint64_t, double, double, string> {
+public:
+    AppArgs() : GenericArgs<string, uint64_t, double, double, string>() {
+        std::get<0>(argTuple_) = "";
+        std::get<1>(argTuple_) = 0;
+        std::get<2>(argTuple_) = betaDefault;
+        std::get<3>(argTuple_) = toleranceDefault;
+        std::get<4>(argTuple_) = "push";
+    };
+
+    const ArgInfo* argInfoList() const {
+        static const ArgInfo list[] = {
+            {"", "<seedFile>", "Seed sets file (required). Each line is a query, with its seed vertex indices"
+                               " separated by spaces or commas."},
+            {"", "[first]", "Index of the first query in the batch (default 0). Run the following "
+                + std::to_string(batchWidth) + " queries at most."},
+            {"", "[beta]", "Damping factor (default " + std::to_string(betaDefault) + "). Should be between 0 and 1."},
+            {"", "[tolerance]", "Residual threshold per out-edge in push mode, or total residual in power mode"
+                " (default " + std::to_string(toleranceDefault) + ")."},
+            {"", "[mode]", "push, or power (default push)."},
+        };
+        return list;
+    }
+
+    bool isValid() const {
+        auto beta = arg<2>();
+        return !arg<0>().empty() && beta > 0 && beta < 1 && arg<3>() > 0
+            && (arg<4>() == "push" || arg<4>() == "power");
+    }
+
+    template<typename KernelType>
+    Ptr<KernelType> algoKernel(const string& kernelName) {
+        auto seedSets = seedSetList();
+        std::cout << "Batch of " << seedSets.size() << " queries from query " << arg<1>() << "." << std::endl;
+        return KernelType::instanceNew(kernelName, seedSets, arg<2>(), arg<3>(), arg<4>() == "push");
+    }
+
+private:
+    static constexpr double betaDefault = 0.85;
+    static constexpr double toleranceDefault = 1e-6;
+
+    /**
+     * Read the seed sets of the queries in the batch. Duplicate seeds are
+     * counted once.
+     */
+    Kernel::SeedSetList seedSetList() const {
+        std::ifstream ifs(arg<0>());
+        if (!ifs.good()) {
+            throw FileException(arg<0>());
+        }
+
+        Kernel::SeedSetList seedSets;
+        string line;
+        for (uint64_t query = 0; std::getline(ifs, line) && seedSets.size() < batchWidth; query++) {
+            if (query < arg<1>()) continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::stringstream ss(line);
+            Kernel::SeedSetList::value_type seeds;
+            uint64_t vid;
+            while (ss >> vid) seeds.push_back(vid);
+            if (!ss.eof()) {
+                throw FileException(arg<0>());
+            }
+            std::sort(seeds.begin(), seeds.end());
+            seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+            seedSets.push_back(seeds);
+        }
+        if (seedSets.empty()) {
+            throw RangeException("No query from query " + std::to_string(arg<1>()) + ".");
+        }
+        return seedSets;
+    }
+};
+
+/*
+ * Output ranked queries as <query>:<rank>.
+ */
+template<typename Data>
+string ppr_vdata(const Data& vd) {
+    std::stringstream ss;
+    for (size_t q = 0; q < vd.rank.size(); q++) {
+        if (vd.rank[q] == 0) continue;
+        if (ss.tellp() > 0) ss << " ";
+        ss << q << ":" << vd.rank[q];
+    }
+    return ss.tellp() > 0 ? ss.str() : "none";
+}
+
+#define VDATA(vd) ppr_vdata(vd)
+
+#endif // KERNEL_HARNESS_H_
@@ -0,0 +1,324 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_PPR_PPR_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_PPR_PPR_H_
+
+#include <array>
+#include <tuple>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+/*
+ * Batched personalized PageRank. Each vertex carries the ranks of a batch of
+ * up to \c Width queries, each with its own seed set, so one pass over the
+ * edges advances all queries.
+ *
+ * Ranks are delta-based as DeltaPageRank. A query starts with a residual of
+ * (1 - beta) spread over its seeds, and a vertex propagates beta times its
+ * residual to its out-neighbors, which accumulate it into both the rank and
+ * the residual. Residuals of vertices without out-edges are dropped. The ranks
+ * of a query sum to at most 1.
+ *
+ * In push mode, only the vertices with some query residual larger than
+ * tolerance times the out-degree are active, and only those queries are
+ * propagated, i.e., forward push. Active vertices are kept in a list, so only
+ * the neighborhood of the seeds is visited. Converge when no vertex is active.
+ *
+ * In power mode, all vertices propagate all their residuals in each
+ * iteration. Converge when the total residual of all queries is at most
+ * tolerance.
+ */
+
+/*
+ * Graph types definitions.
+ */
+template<size_t Width = 16>
+struct PPRData {
+    std::array<double, Width> rank;
+
+    PPRData(const GraphGASLite::VertexIdx&) {
+        rank.fill(0);
+    }
+};
+
+template<size_t Width = 16>
+struct PPRUpdate {
+    std::array<double, Width> contribute;
+
+    PPRUpdate() {
+        contribute.fill(0);
+    }
+
+    PPRUpdate& operator+=(const PPRUpdate& update) {
+        for (size_t q = 0; q < Width; q++) {
+            contribute[q] += update.contribute[q];
+        }
+        return *this;
+    }
+};
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class PPRAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    typedef std::vector< std::vector<GraphGASLite::VertexIdx> > SeedSetList;
+
+    static Ptr<PPRAlgoKernel> instanceNew(const string& name,
+            const SeedSetList& seedSets, const double beta, const double tolerance, const bool push) {
+        return Ptr<PPRAlgoKernel>(new PPRAlgoKernel(name, seedSets, beta, tolerance, push));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphTileType::UpdateType UpdateType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+    typedef decltype(UpdateType::contribute) Lanes;
+
+    static constexpr size_t width = std::tuple_size<Lanes>::value;
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+
+        std::vector<Lanes> rank;
+        std::vector<Lanes> residual;
+
+        // Push mode only. Active vertices to propagate in this and the next
+        // iterations, and whether a vertex is in either list.
+        std::vector<uint32_t> active;
+        std::vector<uint32_t> nextActive;
+        std::vector<bool> queued;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), rank(csc.vertexCount()), residual(csc.vertexCount()), queued(csc.vertexCount(), false)
+        {
+            for (auto& r : rank) r.fill(0);
+            for (auto& r : residual) r.fill(0);
+        }
+
+        uint64_t outDeg(const uint32_t idx) const { return csc.outEdgeOffsets()[idx + 1] - csc.outEdgeOffsets()[idx]; }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        cs.keyValProdDelAll(tid);
+
+        if (push_) {
+            for (const auto idx : state.active) {
+                state.queued[idx] = false;
+                propagate(graph, state, idx);
+            }
+            state.active.clear();
+        } else {
+            for (uint32_t idx = 0; idx < state.csc.vertexCount(); idx++) {
+                propagate(graph, state, idx);
+            }
+        }
+
+        // Only visit the mirror vertices touched in this iteration.
+        for (const auto idx : graph->mirrorVertexDirtyList()) {
+            const auto& mv = graph->mirrorVertexAt(idx);
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), mv.accUpdate());
+        }
+        graph->mirrorVertexDirtyDelAll();
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    accumulate(state, state.csc.vertexIdx(u.key()), u.val());
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+
+        state.active.swap(state.nextActive);
+        // Convergency is decided globally.
+        return true;
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool) const {
+        uint64_t activeCount = 0;
+        double residual = 0;
+        for (auto& graph : graphs) {
+            const auto& state = *states_[graph->tid()];
+            if (push_) {
+                activeCount += state.active.size();
+            } else {
+                for (const auto& r : state.residual) {
+                    for (size_t q = 0; q < width; q++) residual += r[q];
+                }
+            }
+        }
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(activeCount, residual),
+                GraphGASLite::TupleCombiner<GraphGASLite::SumCombiner<uint64_t>, GraphGASLite::SumCombiner<double>>());
+        std::tie(activeCount, residual) = ret;
+
+        if (this->verbose() && workerId == 0) {
+            if (push_) {
+                info("\tIteration %lu: %lu active vertices", iter.cnt(), activeCount);
+            } else {
+                info("\tIteration %lu: residual %g", iter.cnt(), residual);
+            }
+        }
+        return push_ ? activeCount == 0 : residual <= tolerance_;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+
+        // Spread the teleport over the seeds.
+        for (size_t q = 0; q < seedSets_.size(); q++) {
+            const auto& seeds = seedSets_[q];
+            for (const auto& vid : seeds) {
+                // Seed vertex does not exist in this tile.
+                if (graph->vertex(vid) == nullptr) continue;
+                const auto idx = state->csc.vertexIdx(vid);
+                state->rank[idx][q] += (1 - beta_) / seeds.size();
+                state->residual[idx][q] += (1 - beta_) / seeds.size();
+                if (push_) activate(*state, idx, state->active);
+            }
+        }
+
+        states_.stateIs(graph->tid(), state);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            state->csc.vertexAt(idx)->data().rank = state->rank[idx];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    PPRAlgoKernel(const string& name, const SeedSetList& seedSets, const double beta, const double tolerance,
+            const bool push)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name),
+          seedSets_(seedSets), beta_(beta), tolerance_(tolerance), push_(push)
+    {
+        if (seedSets_.size() > width) {
+            throw RangeException("Number of queries " + std::to_string(seedSets_.size())
+                    + " exceeds batch width " + std::to_string(width) + ".");
+        }
+    }
+
+private:
+    const SeedSetList seedSets_;
+    const double beta_;
+    const double tolerance_;
+    const bool push_;
+
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+
+    /**
+     * Residual threshold of a vertex to propagate.
+     */
+    double threshold(const TileState& state, const uint32_t idx) const {
+        return push_ ? tolerance_ * state.outDeg(idx) : 0;
+    }
+
+    /**
+     * Append vertex \c idx to \c list if it is to propagate and not yet queued.
+     */
+    void activate(TileState& state, const uint32_t idx, std::vector<uint32_t>& list) const {
+        if (state.queued[idx] || state.outDeg(idx) == 0) return;
+        const auto thr = threshold(state, idx);
+        bool above = false;
+        for (size_t q = 0; q < width; q++) above |= state.residual[idx][q] > thr;
+        if (!above) return;
+        state.queued[idx] = true;
+        list.push_back(idx);
+    }
+
+    void accumulate(TileState& state, const uint32_t idx, const UpdateType& update) const {
+        auto& rank = state.rank[idx];
+        auto& residual = state.residual[idx];
+        for (size_t q = 0; q < width; q++) {
+            rank[q] += update.contribute[q];
+            residual[q] += update.contribute[q];
+        }
+        if (push_) activate(state, idx, state.nextActive);
+    }
+
+    /**
+     * Propagate the residuals above threshold of vertex \c idx to its
+     * out-neighbors. Local ones accumulate immediately.
+     */
+    void propagate(Ptr<GraphTileType>& graph, TileState& state, const uint32_t idx) const {
+        auto& residual = state.residual[idx];
+        const auto deg = state.outDeg(idx);
+        if (deg == 0) {
+            // Nowhere to go.
+            residual.fill(0);
+            return;
+        }
+
+        // Branch-free over the queries to vectorize.
+        const auto thr = threshold(state, idx);
+        const double scale = beta_ / deg;
+        UpdateType update;
+        bool any = false;
+        for (size_t q = 0; q < width; q++) {
+            const bool above = residual[q] > thr;
+            update.contribute[q] = above ? scale * residual[q] : 0;
+            residual[q] = above ? 0 : residual[q];
+            any |= above;
+        }
+        if (!any) return;
+
+        const auto vertexCount = state.csc.vertexCount();
+        for (auto e = state.csc.outEdgeOffsets()[idx]; e < state.csc.outEdgeOffsets()[idx + 1]; e++) {
+            const auto t = state.csc.outEdgeTargets()[e];
+            if (t < vertexCount) {
+                accumulate(state, t, update);
+            } else {
+                graph->mirrorVertexAt(t - vertexCount).updateNew(update);
+            }
+        }
+    }
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_PPR_PPR_H_
@@ -0,0 +1,228 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_PULLPR_PULLPR_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_PULLPR_PULLPR_H_
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+/*
+ * Pull-based PageRank over the CSC view of each tile.
+ *
+ * Ranks and contributions are kept in dense arrays. Each target, local or
+ * mirror vertex, sums the contributions of its in-edges with vector gathers.
+ * Only one update per mirror vertex is exchanged, and all updates of an
+ * iteration have arrived when the receive phase finishes, so no in-edge
+ * counting is needed.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct PullPageRankData {
+    double rank;
+
+    PullPageRankData(const GraphGASLite::VertexIdx&)
+        : rank(0)
+    {
+        // Nothing else to do.
+    }
+};
+
+// Sum of contributions.
+typedef double PullPageRankUpdate;
+
+
+/**
+ * Sum of <tt>vals[idxs[k]]</tt> for k in [0, count).
+ */
+static inline double pullSum(const double* vals, const uint32_t* idxs, const size_t count) {
+    double sum = 0;
+    size_t k = 0;
+#if defined(__AVX512F__)
+    if (count >= 8) {
+        const auto zero = _mm512_setzero_pd();
+        auto acc = zero;
+        for (; k + 8 <= count; k += 8) {
+            auto vidx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idxs + k));
+            // Masked gather with explicit source, to avoid undefined lanes.
+            acc = _mm512_add_pd(acc, _mm512_mask_i32gather_pd(zero, 0xff, vidx, vals, sizeof(double)));
+        }
+        alignas(64) double lanes[8];
+        _mm512_store_pd(lanes, acc);
+        for (const auto l : lanes) sum += l;
+    }
+#elif defined(__AVX2__)
+    if (count >= 4) {
+        const auto zero = _mm256_setzero_pd();
+        const auto mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        auto acc = zero;
+        for (; k + 4 <= count; k += 4) {
+            auto vidx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idxs + k));
+            // Masked gather with explicit source, to avoid undefined lanes.
+            acc = _mm256_add_pd(acc, _mm256_mask_i32gather_pd(zero, vals, vidx, mask, sizeof(double)));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, acc);
+        for (const auto l : lanes) sum += l;
+    }
+#endif
+    for (; k < count; k++) {
+        sum += vals[idxs[k]];
+    }
+    return sum;
+}
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class PullPageRankAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<PullPageRankAlgoKernel> instanceNew(const string& name,
+            const double beta, const double tolerance) {
+        return Ptr<PullPageRankAlgoKernel>(new PullPageRankAlgoKernel(name, beta, tolerance));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+        std::vector<double> rank;
+        std::vector<double> invOutDeg;
+        // rank / outDeg of the local vertices.
+        std::vector<double> contribute;
+        // Sum of contributions to the local vertices.
+        std::vector<double> sum;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), rank(csc.vertexCount(), 1), invOutDeg(csc.vertexCount(), 0),
+              contribute(csc.vertexCount(), 0), sum(csc.vertexCount(), 0)
+        {
+            for (uint32_t idx = 0; idx < csc.vertexCount(); idx++) {
+                const auto outDeg = csc.vertexAt(idx)->outDeg();
+                if (outDeg != 0) invOutDeg[idx] = 1. / outDeg;
+            }
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+        const auto& csc = state.csc;
+        const auto vertexCount = csc.vertexCount();
+
+        cs.keyValProdDelAll(tid);
+
+        for (uint32_t idx = 0; idx < vertexCount; idx++) {
+            state.contribute[idx] = state.rank[idx] * state.invOutDeg[idx];
+        }
+
+        const auto& offsets = csc.inEdgeOffsets();
+        const auto srcs = csc.inEdgeSrcs().data();
+        const auto contribute = state.contribute.data();
+
+        // Local vertices.
+        for (uint32_t t = 0; t < vertexCount; t++) {
+            state.sum[t] = pullSum(contribute, srcs + offsets[t], offsets[t+1] - offsets[t]);
+        }
+
+        // Mirror vertices, one update each.
+        for (uint32_t t = vertexCount; t < csc.targetCount(); t++) {
+            const auto& mv = graph->mirrorVertexAt(t - vertexCount);
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(),
+                    pullSum(contribute, srcs + offsets[t], offsets[t+1] - offsets[t]));
+        }
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+        const auto& csc = state.csc;
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    state.sum[csc.vertexIdx(u.key())] += u.val();
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+
+        // All contributions have been collected.
+        uint32_t unconverged = 0;
+        for (uint32_t idx = 0; idx < csc.vertexCount(); idx++) {
+            const double newRank = beta_ * state.sum[idx] + (1 - beta_);
+            unconverged += (std::abs(newRank - state.rank[idx]) > tolerance_);
+            state.rank[idx] = newRank;
+        }
+        return unconverged == 0;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+        states_.stateIs(graph->tid(), state);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            state->csc.vertexAt(idx)->data().rank = state->rank[idx];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    PullPageRankAlgoKernel(const string& name, const double beta, const double tolerance)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name),
+          beta_(beta), tolerance_(tolerance)
+    {
+        // Nothing else to do.
+    }
+
+private:
+    const double beta_;
+    const double tolerance_;
+
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_PULLPR_PULLPR_H_
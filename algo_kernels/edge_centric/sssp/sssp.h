@@ -49,13 +49,18 @@ struct SSSPUpdate {
  * Algorithm kernel definition.
  */
 template<typename GraphTileType>
-class SSSPEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<GraphTileType> {
+class SSSPEdgeCentricAlgoKernel : public GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, SSSPEdgeCentricAlgoKernel<GraphTileType>> {
+    typedef GraphGASLite::EdgeCentricAlgoKernel<GraphTileType, SSSPEdgeCentricAlgoKernel<GraphTileType>> BaseKernelType;
+    friend BaseKernelType;
+
 public:
     static Ptr<SSSPEdgeCentricAlgoKernel> instanceNew(const string& name,
             const GraphGASLite::VertexIdx& src) {
         return Ptr<SSSPEdgeCentricAlgoKernel>(new SSSPEdgeCentricAlgoKernel(name, src));
     }
 
+    bool asyncAllowed() const { return true; }
+
 protected:
     typedef typename GraphTileType::UpdateType UpdateType;
     typedef typename GraphTileType::VertexType VertexType;
@@ -63,7 +68,8 @@ protected:
 
     std::pair<UpdateType, bool> scatter(const GraphGASLite::IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
         auto& data = src->data();
-        if (data.activeIter == iter) {
+        // In asynchronous mode, also scatter vertices updated earlier in this iteration.
+        if (data.activeIter == iter || (this->async() && data.activeIter == iter + 1)) {
             return std::make_pair(SSSPUpdate<EdgeWeightType>(data.distance + weight, src->vid()), true);
         } else {
             return std::make_pair(SSSPUpdate<EdgeWeightType>(), false);
@@ -83,6 +89,14 @@ protected:
     }
 
     void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        // Reset results of the last run.
+        for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+            auto& data = vertexIter->second->data();
+            data.distance = INF(EdgeWeightType);
+            data.predecessor = INV_VID;
+            data.activeIter = -1;
+        }
+
         // Set source vertex.
         auto vsrc = graph->vertex(src_);
         // Source vertex does not exist.
@@ -93,7 +107,7 @@ protected:
 
 protected:
     SSSPEdgeCentricAlgoKernel(const string& name, const GraphGASLite::VertexIdx& src)
-        : GraphGASLite::EdgeCentricAlgoKernel<GraphTileType>(name),
+        : BaseKernelType(name),
           src_(src)
     {
         // Nothing else to do.
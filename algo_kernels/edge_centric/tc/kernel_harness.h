@@ -0,0 +1,24 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include "harness.h"
+#include "tc.h"
+
+typedef GraphGASLite::GraphTile<TriangleData, TriangleUpdate> Graph;
+typedef TriangleCountAlgoKernel<Graph> Kernel;
+
+const char appName[] = "tc";
+
+class AppArgs : public GenericArgs<> {
+public:
+    AppArgs() : GenericArgs<>() { };
+
+    const ArgInfo* argInfoList() const {
+        // No app-specific arguments.
+        return nullptr;
+    }
+};
+
+#define VDATA(vd) std::to_string(vd.triangles) + "\t" + std::to_string(vd.lcc)
+
+#endif // KERNEL_HARNESS_H_
@@ -0,0 +1,434 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_TC_TC_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_TC_TC_H_
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+/*
+ * Triangle counting and local clustering coefficient, on undirected graphs.
+ *
+ * Each edge is oriented from the endpoint with lower (degree, index) to the
+ * other one, and each triangle is found once as the intersection of the
+ * oriented neighbor lists of the two endpoints of its lowest edge. The lists
+ * are sorted, as the tile edges are sorted by source and destination, and
+ * are intersected with SIMD block merges.
+ *
+ * Runs in three iterations:
+ * 0. Send the degrees of the boundary vertices to the adjacent tiles, and
+ *    orient the edges.
+ * 1. Send the oriented lists needed by other tiles, once per tile pair, in
+ *    bulk rather than as key-value pairs.
+ * 2. Intersect, and send the triangle counts of mirror vertices.
+ *
+ * The input must be loaded as undirected. Directed input is not rejected, but
+ * the counts are then not meaningful.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct TriangleData {
+    uint64_t triangles;
+    // Local clustering coefficient.
+    double lcc;
+
+    TriangleData(const GraphGASLite::VertexIdx&)
+        : triangles(0), lcc(0)
+    {
+        // Nothing else to do.
+    }
+};
+
+// Triangle count.
+typedef uint64_t TriangleUpdate;
+
+
+/**
+ * Call \c func with the index \c i of each <tt>a[i]</tt> also in \c b. Both
+ * arrays are sorted without duplicates.
+ */
+template<typename Func>
+static inline void intersect(const uint64_t* a, const size_t na, const uint64_t* b, const size_t nb, Func&& func) {
+    size_t i = 0;
+    size_t j = 0;
+#if defined(__AVX512F__)
+    constexpr size_t W = 8;
+    while (i + W <= na && j + W <= nb) {
+        const auto va = _mm512_loadu_si512(a + i);
+        const auto vb = _mm512_loadu_si512(b + j);
+        // Compare all pairs in the two blocks by rotating one of them. Use
+        // zero-masked rotation with all lanes, to avoid undefined sources.
+        const __mmask8 all = 0xff;
+        auto mask = _mm512_cmpeq_epi64_mask(va, vb);
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 1));
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 2));
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 3));
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 4));
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 5));
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 6));
+        mask |= _mm512_cmpeq_epi64_mask(va, _mm512_maskz_alignr_epi64(all, vb, vb, 7));
+        for (uint32_t bits = mask; bits != 0; bits &= bits - 1) {
+            func(i + __builtin_ctz(bits));
+        }
+        const auto amax = a[i + W - 1];
+        const auto bmax = b[j + W - 1];
+        if (amax <= bmax) i += W;
+        if (bmax <= amax) j += W;
+    }
+#elif defined(__AVX2__)
+    constexpr size_t W = 4;
+    while (i + W <= na && j + W <= nb) {
+        const auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        // Compare all pairs in the two blocks by rotating one of them.
+        auto cmp = _mm256_cmpeq_epi64(va, vb);
+        vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+        cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi64(va, vb));
+        vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+        cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi64(va, vb));
+        vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+        cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi64(va, vb));
+        for (uint32_t bits = _mm256_movemask_pd(_mm256_castsi256_pd(cmp)); bits != 0; bits &= bits - 1) {
+            func(i + __builtin_ctz(bits));
+        }
+        const auto amax = a[i + W - 1];
+        const auto bmax = b[j + W - 1];
+        if (amax <= bmax) i += W;
+        if (bmax <= amax) j += W;
+    }
+#endif
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            func(i);
+            i++;
+            j++;
+        }
+    }
+}
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class TriangleCountAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<TriangleCountAlgoKernel> instanceNew(const string& name) {
+        return Ptr<TriangleCountAlgoKernel>(new TriangleCountAlgoKernel(name));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::GraphTileList GraphTileList;
+    typedef GraphGASLite::VertexIdx::Type VidType;
+
+    /**
+     * Adjacency lists of local vertices, as sorted vertex indices and the
+     * corresponding targets in the CSC view.
+     */
+    struct AdjList {
+        std::vector<size_t> offsets;
+        std::vector<VidType> vids;
+        std::vector<uint32_t> targets;
+
+        size_t size(const uint32_t idx) const { return offsets[idx + 1] - offsets[idx]; }
+    };
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+        // Distinct neighbors, excluding self loops.
+        AdjList adj;
+        // Oriented neighbors, after the degrees of mirror vertices are known.
+        AdjList oriented;
+        // Degree of each target.
+        std::vector<uint64_t> degree;
+        // Tile of each target.
+        std::vector<uint32_t> tile;
+        // Target index of each mirror vertex.
+        std::unordered_map<VidType, uint32_t> mirrorTargets;
+        // Oriented lists of remote vertices, in the received bulk buffers.
+        std::unordered_map<VidType, std::pair<const uint64_t*, size_t>> remoteOriented;
+        // Triangle counts of each target found in this tile.
+        std::vector<uint64_t> triangles;
+        uint64_t triangleCount;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), degree(csc.targetCount(), 0), tile(csc.targetCount(), graph->tid()),
+              triangles(csc.targetCount(), 0), triangleCount(0)
+        {
+            const auto vertexCount = csc.vertexCount();
+            for (uint32_t m = 0; m < graph->mirrorVertexCount(); m++) {
+                const auto& mv = graph->mirrorVertexAt(m);
+                mirrorTargets[mv.vid()] = vertexCount + m;
+                tile[vertexCount + m] = mv.masterTileId();
+            }
+
+            // Edges are sorted by source then destination, so the neighbors
+            // of each vertex are contiguous and sorted.
+            std::vector<size_t> counts(vertexCount + 1, 0);
+            VidType lastSrc = -1uL;
+            VidType lastDst = -1uL;
+            for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
+                const VidType src = edgeIter->srcId();
+                const VidType dst = edgeIter->dstId();
+                if (src == dst || (src == lastSrc && dst == lastDst)) continue;
+                lastSrc = src;
+                lastDst = dst;
+                const auto s = csc.vertexIdx(src);
+                const auto mirrorIdx = edgeIter->dstMirrorIdx();
+                counts[s + 1]++;
+                adj.vids.push_back(dst);
+                adj.targets.push_back(mirrorIdx == GraphGASLite::INV_MIRROR_VERTEX_IDX
+                        ? csc.vertexIdx(dst) : vertexCount + mirrorIdx);
+            }
+            // Dense indices are not in the order of vertex indices.
+            adj.offsets.assign(vertexCount + 1, 0);
+            for (uint32_t idx = 0; idx < vertexCount; idx++) {
+                adj.offsets[idx + 1] = adj.offsets[idx] + counts[idx + 1];
+            }
+            std::vector<VidType> vids(adj.vids.size());
+            std::vector<uint32_t> targets(adj.targets.size());
+            std::vector<size_t> pos(adj.offsets.begin(), adj.offsets.end() - 1);
+            size_t e = 0;
+            for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ) {
+                const VidType src = edgeIter->srcId();
+                const auto s = csc.vertexIdx(src);
+                const auto n = counts[s + 1];
+                std::copy(adj.vids.begin() + e, adj.vids.begin() + e + n, vids.begin() + pos[s]);
+                std::copy(adj.targets.begin() + e, adj.targets.begin() + e + n, targets.begin() + pos[s]);
+                e += n;
+                while (edgeIter != graph->edgeIterEnd() && edgeIter->srcId() == src) ++edgeIter;
+            }
+            adj.vids.swap(vids);
+            adj.targets.swap(targets);
+
+            for (uint32_t idx = 0; idx < vertexCount; idx++) degree[idx] = adj.size(idx);
+        }
+
+        /**
+         * If the edge is oriented from target \c t1 to target \c t2.
+         */
+        bool lower(const uint32_t t1, const VidType vid1, const uint32_t t2, const VidType vid2) const {
+            return degree[t1] < degree[t2] || (degree[t1] == degree[t2] && vid1 < vid2);
+        }
+
+        void orient() {
+            const auto vertexCount = csc.vertexCount();
+            oriented.offsets.assign(vertexCount + 1, 0);
+            for (uint32_t idx = 0; idx < vertexCount; idx++) {
+                const VidType vid = csc.vertexAt(idx)->vid();
+                for (auto e = adj.offsets[idx]; e < adj.offsets[idx + 1]; e++) {
+                    if (lower(idx, vid, adj.targets[e], adj.vids[e])) {
+                        oriented.vids.push_back(adj.vids[e]);
+                        oriented.targets.push_back(adj.targets[e]);
+                    }
+                }
+                oriented.offsets[idx + 1] = oriented.vids.size();
+            }
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount& iter) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+        const auto vertexCount = state.csc.vertexCount();
+        const auto& adj = state.adj;
+
+        if (iter == 0 || iter == 1) {
+            // Send each vertex at most once to each tile.
+            std::vector<uint32_t> lastSent(cs.endpointCount(), -1u);
+            for (uint32_t idx = 0; idx < vertexCount; idx++) {
+                const VidType vid = state.csc.vertexAt(idx)->vid();
+                for (auto e = adj.offsets[idx]; e < adj.offsets[idx + 1]; e++) {
+                    const auto t = adj.targets[e];
+                    const auto dtid = state.tile[t];
+                    if (t < vertexCount || lastSent[dtid] == idx) continue;
+                    if (iter == 0) {
+                        // Degree of boundary vertex.
+                        const uint64_t words[] = {vid, state.degree[idx]};
+                        cs.bulkNew(tid, dtid, words, 2);
+                        lastSent[dtid] = idx;
+                    } else if (state.lower(t, adj.vids[e], idx, vid)) {
+                        // Oriented list of vertex in the oriented list of a remote vertex.
+                        const uint64_t words[] = {vid, state.oriented.size(idx)};
+                        cs.bulkNew(tid, dtid, words, 2);
+                        cs.bulkNew(tid, dtid, state.oriented.vids.data() + state.oriented.offsets[idx],
+                                state.oriented.size(idx));
+                        lastSent[dtid] = idx;
+                    }
+                }
+            }
+            return true;
+        }
+
+        cs.keyValProdDelAll(tid);
+
+        // Each triangle is counted at its lowest vertex u, with the edge to its
+        // second lowest vertex v.
+        const auto& oriented = state.oriented;
+        for (uint32_t u = 0; u < vertexCount; u++) {
+            const auto ua = oriented.vids.data() + oriented.offsets[u];
+            const auto ut = oriented.targets.data() + oriented.offsets[u];
+            const auto un = oriented.size(u);
+            for (size_t k = 0; k < un; k++) {
+                const auto v = ut[k];
+                const uint64_t* va = nullptr;
+                size_t vn = 0;
+                if (v < vertexCount) {
+                    va = oriented.vids.data() + oriented.offsets[v];
+                    vn = oriented.size(v);
+                } else {
+                    auto it = state.remoteOriented.find(ua[k]);
+                    if (it == state.remoteOriented.end()) continue;
+                    va = it->second.first;
+                    vn = it->second.second;
+                }
+                uint64_t found = 0;
+                intersect(ua, un, va, vn, [&](const size_t w) {
+                    state.triangles[ut[w]]++;
+                    found++;
+                });
+                state.triangles[u] += found;
+                state.triangles[v] += found;
+                state.triangleCount += found;
+            }
+        }
+
+        for (uint32_t t = vertexCount; t < state.csc.targetCount(); t++) {
+            if (state.triangles[t] == 0) continue;
+            const auto& mv = graph->mirrorVertexAt(t - vertexCount);
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), state.triangles[t]);
+        }
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount& iter) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        if (iter == 0) {
+            for (uint32_t prodId = 0; prodId < cs.endpointCount(); prodId++) {
+                const auto& buf = cs.bulk(prodId, tid);
+                for (size_t pos = 0; pos < buf.size(); pos += 2) {
+                    // Without the reverse edge, e.g., on directed input, the
+                    // sender is not a mirror vertex in this tile.
+                    auto it = state.mirrorTargets.find(buf[pos]);
+                    if (it == state.mirrorTargets.end()) continue;
+                    state.degree[it->second] = buf[pos + 1];
+                }
+            }
+            cs.bulkConsDelAll(tid);
+            state.orient();
+            return false;
+        }
+
+        if (iter == 1) {
+            // Keep the buffers until counted.
+            for (uint32_t prodId = 0; prodId < cs.endpointCount(); prodId++) {
+                const auto& buf = cs.bulk(prodId, tid);
+                for (size_t pos = 0; pos < buf.size(); pos += 2 + buf[pos + 1]) {
+                    state.remoteOriented[buf[pos]] = std::make_pair(buf.data() + pos + 2, buf[pos + 1]);
+                }
+            }
+            return false;
+        }
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    state.triangles[state.csc.vertexIdx(u.key())] += u.val();
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+        state.remoteOriented.clear();
+        cs.bulkConsDelAll(tid);
+
+        for (uint32_t idx = 0; idx < state.csc.vertexCount(); idx++) {
+            auto& data = state.csc.vertexAt(idx)->data();
+            const double deg = state.degree[idx];
+            data.triangles = state.triangles[idx];
+            data.lcc = deg > 1 ? 2. * data.triangles / (deg * (deg - 1)) : 0.;
+        }
+
+        return true;
+    }
+
+    bool onIterationSync(GraphTileList& graphs, CommSyncType& cs, const uint32_t workerId,
+            const GraphGASLite::IterCount& iter, const bool converged) const {
+        uint64_t triangleCount = 0;
+        for (auto& graph : graphs) {
+            triangleCount += states_[graph->tid()]->triangleCount;
+        }
+        auto ret = cs.barrierReduce(workerId, std::make_tuple(converged, triangleCount),
+                GraphGASLite::TupleCombiner<GraphGASLite::ANDCombiner, GraphGASLite::SumCombiner<uint64_t>>());
+        if (std::get<0>(ret) && this->verbose() && workerId == 0) {
+            info("\tIteration %lu: %lu triangles", iter.cnt(), std::get<1>(ret));
+        }
+        return std::get<0>(ret);
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+        states_.stateIs(graph->tid(), state);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    explicit TriangleCountAlgoKernel(const string& name)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name)
+    {
+        // Nothing else to do.
+    }
+
+private:
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_TC_TC_H_
@@ -0,0 +1,24 @@
+#ifndef KERNEL_HARNESS_H_
+#define KERNEL_HARNESS_H_
+
+#include "harness.h"
+#include "wcc.h"
+
+typedef GraphGASLite::GraphTile<WCCData, WCCUpdate> Graph;
+typedef WCCAlgoKernel<Graph> Kernel;
+
+const char appName[] = "wcc";
+
+class AppArgs : public GenericArgs<> {
+public:
+    AppArgs() : GenericArgs<>() { };
+
+    const ArgInfo* argInfoList() const {
+        // No app-specific arguments.
+        return nullptr;
+    }
+};
+
+#define VDATA(vd) vd.label
+
+#endif // KERNEL_HARNESS_H_
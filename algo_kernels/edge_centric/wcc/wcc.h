@@ -0,0 +1,313 @@
+#ifndef ALGO_KERNELS_EDGE_CENTRIC_WCC_WCC_H_
+#define ALGO_KERNELS_EDGE_CENTRIC_WCC_WCC_H_
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "graph.h"
+#include "csc_tile.h"
+#include "algo_kernel.h"
+
+#define INV_LABEL std::numeric_limits<GraphGASLite::VertexIdx::Type>::max()
+#define INV_VID -1uL
+#define INV_TILE -1u
+
+/*
+ * Weakly connected components.
+ *
+ * Each tile first finds the components of its local edges with union-find,
+ * so a component is a single root within the tile. Then labels, the minimum
+ * vertex index of each component, are propagated across tiles. Only the
+ * lowered labels of roots are sent, once per mirror vertex, and a received
+ * label relabels the whole local component at once.
+ *
+ * A label is also a vertex in the same component. Similar to hooking and
+ * pointer jumping in Shiloach-Vishkin, a relabeled component sends its new
+ * label to its old label vertex, and asks the tile of its new label vertex
+ * for the label of that vertex, which is often lower. So labels jump along
+ * the label vertices instead of crawling along the edges. Each label carries
+ * the tile of its vertex, so the hooks and requests are routed without
+ * looking up the vertex.
+ *
+ * Labels only propagate along the edge direction, so directed graphs should
+ * be loaded as undirected.
+ */
+
+/*
+ * Graph types definitions.
+ */
+struct WCCData {
+    GraphGASLite::VertexIdx::Type label;
+
+    WCCData(const GraphGASLite::VertexIdx& vid)
+        : label(vid)
+    {
+        // Nothing else to do.
+    }
+};
+
+struct WCCUpdate {
+    // Component label, and the tile of the label vertex.
+    GraphGASLite::VertexIdx::Type label;
+    uint32_t labelTile;
+    // If not INV_VID, also request the label of the destination vertex, to be
+    // sent back to this vertex in tile replyTile.
+    uint32_t replyTile;
+    GraphGASLite::VertexIdx::Type replyTo;
+
+    WCCUpdate(const GraphGASLite::VertexIdx::Type label_ = INV_LABEL, const uint32_t labelTile_ = INV_TILE,
+            const GraphGASLite::VertexIdx::Type replyTo_ = INV_VID, const uint32_t replyTile_ = INV_TILE)
+        : label(label_), labelTile(labelTile_), replyTile(replyTile_), replyTo(replyTo_)
+    {
+        // Nothing else to do.
+    }
+};
+
+
+/*
+ * Algorithm kernel definition.
+ */
+template<typename GraphTileType>
+class WCCAlgoKernel : public GraphGASLite::BaseAlgoKernel<GraphTileType> {
+public:
+    static Ptr<WCCAlgoKernel> instanceNew(const string& name) {
+        return Ptr<WCCAlgoKernel>(new WCCAlgoKernel(name));
+    }
+
+    GraphGASLite::AlgoKernelTag tag() const {
+        return GraphGASLite::AlgoKernelTag::EdgeCentric;
+    }
+
+protected:
+    typedef typename GraphGASLite::BaseAlgoKernel<GraphTileType>::CommSyncType CommSyncType;
+    typedef GraphGASLite::VertexIdx::Type LabelType;
+
+    /**
+     * Label requested by another tile, to be sent back.
+     */
+    struct Reply {
+        GraphGASLite::VertexIdx::Type vid;
+        uint32_t tile;
+        LabelType label;
+        uint32_t labelTile;
+    };
+
+    /**
+     * Dense per-tile state, indexed as the CSC view.
+     */
+    struct TileState {
+        GraphGASLite::CSCTile<GraphTileType> csc;
+        // Union-find forest of the local edges. Always link to the smaller
+        // index, so parent[idx] <= idx.
+        std::vector<uint32_t> parent;
+        // Label of each root, and the tile of the label vertex.
+        std::vector<LabelType> label;
+        std::vector<uint32_t> labelTile;
+        // Root label has been lowered but not yet sent.
+        std::vector<bool> changed;
+        // Label of each root before lowered by received updates.
+        std::vector<LabelType> prevLabel;
+        std::vector<uint32_t> prevLabelTile;
+        // Distinct mirror vertices reached from each root, as dense mirror
+        // indices in [rootMirrorOffsets[r], rootMirrorOffsets[r+1]).
+        std::vector<uint32_t> rootMirrorOffsets;
+        std::vector<uint32_t> rootMirrors;
+        // Lowest label sent to each mirror vertex.
+        std::vector<LabelType> mirrorLabel;
+        std::vector<uint32_t> mirrorLabelTile;
+        std::vector<bool> mirrorDirty;
+        // Labels requested by other tiles.
+        std::vector<Reply> replies;
+
+        explicit TileState(const Ptr<GraphTileType>& graph)
+            : csc(graph), parent(csc.vertexCount()), label(csc.vertexCount(), INV_LABEL),
+              labelTile(csc.vertexCount(), graph->tid()), changed(csc.vertexCount(), true),
+              prevLabel(csc.vertexCount(), INV_LABEL), prevLabelTile(csc.vertexCount(), INV_TILE),
+              mirrorLabel(csc.targetCount() - csc.vertexCount(), INV_LABEL),
+              mirrorLabelTile(csc.targetCount() - csc.vertexCount(), INV_TILE),
+              mirrorDirty(csc.targetCount() - csc.vertexCount(), false)
+        {
+            const auto vertexCount = csc.vertexCount();
+            const auto& offsets = csc.inEdgeOffsets();
+            const auto& srcs = csc.inEdgeSrcs();
+
+            for (uint32_t idx = 0; idx < vertexCount; idx++) parent[idx] = idx;
+            for (uint32_t t = 0; t < vertexCount; t++) {
+                for (auto e = offsets[t]; e < offsets[t+1]; e++) link(srcs[e], t);
+            }
+            // Pointer jumping. Parents have smaller indices, so are already
+            // pointing to roots.
+            for (uint32_t idx = 0; idx < vertexCount; idx++) parent[idx] = parent[parent[idx]];
+
+            for (uint32_t idx = 0; idx < vertexCount; idx++) {
+                auto& l = label[parent[idx]];
+                l = std::min<LabelType>(l, csc.vertexAt(idx)->vid());
+            }
+
+            // Group the distinct (root, mirror) pairs by root.
+            std::vector<std::pair<uint32_t, uint32_t>> pairs;
+            for (uint32_t t = vertexCount; t < csc.targetCount(); t++) {
+                for (auto e = offsets[t]; e < offsets[t+1]; e++) {
+                    pairs.emplace_back(parent[srcs[e]], t - vertexCount);
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+            rootMirrorOffsets.assign(vertexCount + 1, 0);
+            rootMirrors.reserve(pairs.size());
+            for (const auto& p : pairs) {
+                rootMirrorOffsets[p.first + 1]++;
+                rootMirrors.push_back(p.second);
+            }
+            for (uint32_t idx = 0; idx < vertexCount; idx++) {
+                rootMirrorOffsets[idx + 1] += rootMirrorOffsets[idx];
+            }
+        }
+
+        uint32_t find(uint32_t idx) {
+            // Path halving.
+            while (parent[idx] != idx) {
+                parent[idx] = parent[parent[idx]];
+                idx = parent[idx];
+            }
+            return idx;
+        }
+
+        void link(const uint32_t idx1, const uint32_t idx2) {
+            const auto r1 = find(idx1);
+            const auto r2 = find(idx2);
+            if (r1 < r2) parent[r2] = r1;
+            else if (r2 < r1) parent[r1] = r2;
+        }
+    };
+
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount& iter) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        cs.keyValProdDelAll(tid);
+
+        for (const auto& reply : state.replies) {
+            cs.keyValNew(tid, reply.tile, reply.vid, WCCUpdate(reply.label, reply.labelTile));
+        }
+        state.replies.clear();
+
+        // Lower the labels of the mirror vertices reached by changed roots.
+        std::vector<uint32_t> dirtyMirrors;
+        for (uint32_t r = 0; r < state.csc.vertexCount(); r++) {
+            if (!state.changed[r]) continue;
+            state.changed[r] = false;
+            // Initial labels are local vertices. Later labels are received
+            // from other components, so hook the old label vertex, and jump
+            // through the new one.
+            const auto label = state.label[r];
+            const auto labelTile = state.labelTile[r];
+            if (iter > 0) {
+                const auto prev = state.prevLabel[r];
+                cs.keyValNew(tid, state.prevLabelTile[r], prev, WCCUpdate(label, labelTile));
+                cs.keyValNew(tid, labelTile, label, WCCUpdate(label, labelTile, state.csc.vertexAt(r)->vid(), tid));
+            }
+            for (auto pos = state.rootMirrorOffsets[r]; pos < state.rootMirrorOffsets[r+1]; pos++) {
+                const auto m = state.rootMirrors[pos];
+                if (label < state.mirrorLabel[m]) {
+                    state.mirrorLabel[m] = label;
+                    state.mirrorLabelTile[m] = labelTile;
+                    if (!state.mirrorDirty[m]) {
+                        state.mirrorDirty[m] = true;
+                        dirtyMirrors.push_back(m);
+                    }
+                }
+            }
+        }
+
+        for (const auto m : dirtyMirrors) {
+            state.mirrorDirty[m] = false;
+            const auto& mv = graph->mirrorVertexAt(m);
+            cs.keyValNew(tid, mv.masterTileId(), mv.vid(), WCCUpdate(state.mirrorLabel[m], state.mirrorLabelTile[m]));
+        }
+
+        for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+            cs.endTagNew(tid, idx);
+        }
+
+        return true;
+    }
+
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const GraphGASLite::IterCount&) const {
+        const auto tid = graph->tid();
+        auto& state = *states_[tid];
+
+        auto hf = std::hash<GraphGASLite::VertexIdx::Type>();
+        auto dstIdHash = [&hf](const GraphGASLite::VertexIdx& k) {
+            return hf(k);
+        };
+        uint32_t unconverged = 0;
+        while (true) {
+            // All tiles have finished sending, no need to sync again.
+            auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
+            const auto& updatePartitions = recvData.first;
+            auto recvStatus = recvData.second;
+
+            if (recvStatus == CommSyncType::RECV_NONE) {
+                // Sleep shortly to wait for data.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            for (const auto& prtn : updatePartitions) {
+                for (const auto& u : prtn) {
+                    // Relabel the whole local component.
+                    const auto r = state.parent[state.csc.vertexIdx(u.key())];
+                    const auto& update = u.val();
+                    if (update.label < state.label[r]) {
+                        if (!state.changed[r]) {
+                            state.prevLabel[r] = state.label[r];
+                            state.prevLabelTile[r] = state.labelTile[r];
+                        }
+                        state.label[r] = update.label;
+                        state.labelTile[r] = update.labelTile;
+                        state.changed[r] = true;
+                        unconverged++;
+                    } else if (update.replyTo != INV_VID && state.label[r] < update.label) {
+                        state.replies.push_back({update.replyTo, update.replyTile, state.label[r], state.labelTile[r]});
+                        unconverged++;
+                    }
+                }
+            }
+
+            // Finish receiving.
+            if (recvStatus == CommSyncType::RECV_FINISHED) break;
+        }
+
+        cs.keyValConsDelAll(tid);
+
+        return unconverged == 0;
+    }
+
+    void onAlgoKernelStart(Ptr<GraphTileType>& graph) const {
+        auto state = Ptr<TileState>(new TileState(graph));
+        states_.stateIs(graph->tid(), state);
+    }
+
+    void onAlgoKernelEnd(Ptr<GraphTileType>& graph) const {
+        auto& state = states_[graph->tid()];
+        for (uint32_t idx = 0; idx < state->csc.vertexCount(); idx++) {
+            state->csc.vertexAt(idx)->data().label = state->label[state->parent[idx]];
+        }
+        states_.stateDel(graph->tid());
+    }
+
+protected:
+    explicit WCCAlgoKernel(const string& name)
+        : GraphGASLite::BaseAlgoKernel<GraphTileType>(name)
+    {
+        // Nothing else to do.
+    }
+
+private:
+    // Indexed by tile.
+    mutable GraphGASLite::TileStateList<TileState> states_;
+};
+
+#endif // ALGO_KERNELS_EDGE_CENTRIC_WCC_WCC_H_
@@ -3,8 +3,12 @@
 
 #include <chrono>
 #include <limits>
+#include <type_traits>
+#include <vector>
 #include "comm_sync.h"
 #include "graph.h"
+#include "tile_scheduler.h"
+#include "utils/threads.h"
 
 namespace GraphGASLite {
 
@@ -26,8 +30,43 @@ typedef CountType<uint64_t, IterCountRepType> IterCount;
 
 static constexpr auto INF_ITER_COUNT = std::numeric_limits<typename IterCount::Type>::max();
 
+/**
+ * Per-tile states of an algorithm kernel, indexed by tile.
+ *
+ * States are added at start of the algorithm kernel, when tiles may be started
+ * by different workers, so only adding takes the lock. Accesses in iterations
+ * do not.
+ */
+template<typename StateType>
+class TileStateList {
+public:
+    const Ptr<StateType>& operator[](const uint32_t tid) const {
+        return states_[tid];
+    }
+
+    void stateIs(const uint32_t tid, const Ptr<StateType>& state) {
+        mutex_begin(uqlk, lock_);
+        if (states_.size() <= tid) {
+            states_.resize(tid + 1);
+        }
+        states_[tid] = state;
+        mutex_end();
+    }
+
+    void stateDel(const uint32_t tid) {
+        states_[tid] = nullptr;
+    }
+
+private:
+    std::vector< Ptr<StateType> > states_;
+    lock_t lock_;
+};
+
 template<typename GraphTileType>
 class BaseAlgoKernel {
+public:
+    typedef std::vector< Ptr<GraphTileType> > GraphTileList;
+
 protected:
     typedef CommSync<VertexIdx, typename GraphTileType::UpdateType> CommSyncType;
 
@@ -69,36 +108,96 @@ public:
     }
 
     /**
-     * Call the algorithm kernel. Run iterations.
+     * Asynchronous (Gauss-Seidel) mode.
+     *
+     * Updates to local destinations are applied immediately during scatter,
+     * so they can be propagated further in the same iteration. With static
+     * scheduling, i.e., each tile bound to a worker, updates to remote tiles
+     * are also streamed to and gathered by their tiles during scatter, and
+     * the scatter phase runs until no tile has updates left to apply or
+     * deliver, after which the kernel terminates. With dynamic scheduling,
+     * updates to remote tiles are still exchanged at the end of each
+     * iteration.
+     *
+     * Only allowed if the kernel tolerates gathering an update in the middle
+     * of the scatter phase, and the fixpoint reached so is the result, see
+     * asyncAllowed().
+     */
+    bool async() const { return async_; }
+    void asyncIs(const bool async) {
+        if (async && !asyncAllowed()) {
+            throw PermissionException(string(__func__) + ": Algorithm kernel " + name_
+                    + " does not allow asynchronous mode.");
+        }
+        async_ = async;
+    }
+
+    /**
+     * If the kernel allows asynchronous mode.
+     */
+    virtual bool asyncAllowed() const { return false; }
+
+    /**
+     * Call the algorithm kernel as one of the worker threads. Run iterations.
      *
      * The algorithm kernel is defined as a functor class.
      *
-     * @param graph     Graph tile on which this kernel works.
-     * @param cs        Utility for comm & sync.
+     * Each iteration is split into a send phase and a receive phase separated
+     * by a barrier. In each phase the graph tiles are distributed to the
+     * workers by the tile scheduler.
+     *
+     * @param graphs    All graph tiles.
+     * @param cs        Utility for comm & sync. Communication is indexed by
+     *                  tile, and synchronization is indexed by worker.
+     * @param sched     Tile scheduler.
+     * @param workerId  Index of this worker.
      */
-    void operator()(Ptr<GraphTileType>& graph, CommSyncType& cs) const {
-        // If need to print progress, i.e., verbose kernel and primary (index 0) tile.
-        auto printProgress = verbose() && (graph->tid() == 0);
+    void operator()(GraphTileList& graphs, CommSyncType& cs, TileScheduler& sched,
+            const uint32_t workerId) const {
+        // If need to print progress, i.e., verbose kernel and primary (index 0) worker.
+        auto printProgress = verbose() && (workerId == 0);
 
         // Start barrier, ensure all preparation is done in all threads.
-        cs.barrier(graph->tid());
+        cs.barrier(workerId);
+
+        sched.tileForEach(workerId, [&](const uint32_t idx) {
+            onAlgoKernelStart(graphs[idx]);
+        });
 
-        onAlgoKernelStart(graph);
+        // Tiles may be started and iterated by different workers.
+        cs.barrier(workerId);
+
+        // Tiles received by this worker in the current iteration.
+        GraphTileList recvGraphs;
 
         IterCount iter(0);
         bool allConverged = false;
         while (!allConverged && iter < maxIters()) {
-            bool converged = onIteration(graph, cs, iter);
-            onIterationEnd(graph, iter);
+            bool converged = true;
+            sched.tileForEach(workerId, [&](const uint32_t idx) {
+                converged &= onIterationSend(graphs[idx], cs, iter);
+            });
+
+            // Ensure all tiles have finished sending.
+            cs.barrier(workerId);
+
+            recvGraphs.clear();
+            sched.tileForEach(workerId, [&](const uint32_t idx) {
+                converged &= onIterationRecv(graphs[idx], cs, iter);
+                onIterationEnd(graphs[idx], iter);
+                recvGraphs.push_back(graphs[idx]);
+            });
             if (printProgress) info("->%lu", iter.cnt());
 
             // Check if all tiles have converged.
-            allConverged = cs.barrierAND(graph->tid(), converged);
+            allConverged = onIterationSync(recvGraphs, cs, workerId, iter, converged);
             iter++;
         }
         if (printProgress) info("Completed in %lu iterations", iter.cnt());
 
-        onAlgoKernelEnd(graph);
+        sched.tileForEach(workerId, [&](const uint32_t idx) {
+            onAlgoKernelEnd(graphs[idx]);
+        });
     }
 
 protected:
@@ -107,6 +206,25 @@ protected:
      */
     virtual void onIterationEnd(Ptr<GraphTileType>&, const IterCount&) const { }
 
+    /**
+     * Synchronize all workers at the end of each iteration, and check if all
+     * tiles have converged.
+     *
+     * By default do an AND reduction of the convergence of each worker.
+     * Kernels can override it to fuse global aggregations into the same
+     * barrier, using CommSyncType::barrierReduce() with a TupleCombiner.
+     *
+     * @param graphs        Graph tiles received by this worker in this iteration.
+     * @param workerId      Index of this worker.
+     * @param converged     If converged in all tiles of this worker.
+     *
+     * @return              If all tiles have converged.
+     */
+    virtual bool onIterationSync(GraphTileList&, CommSyncType& cs, const uint32_t workerId,
+            const IterCount&, const bool converged) const {
+        return cs.barrierAND(workerId, converged);
+    }
+
     /**
      * Operations on start of the algorithm kernel.
      */
@@ -119,7 +237,23 @@ protected:
 
 protected:
     /**
-     * Iteration.
+     * Send phase of the iteration.
+     *
+     * Must not take any barrier, as tiles are not bound to threads.
+     *
+     * @param graph     Graph tile on which this kernel works.
+     * @param cs        Utility for comm & sync.
+     * @param iter      Current iteration count.
+     *
+     * @return          If converged in this tile w.r.t. the updates applied
+     *                  in this phase, e.g., in asynchronous mode.
+     */
+    virtual bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const = 0;
+
+    /**
+     * Receive phase of the iteration, after all tiles have finished sending.
+     *
+     * Must not take any barrier, as tiles are not bound to threads.
      *
      * @param graph     Graph tile on which this kernel works.
      * @param cs        Utility for comm & sync.
@@ -127,17 +261,18 @@ protected:
      *
      * @return          If converged in this tile.
      */
-    virtual bool onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const = 0;
+    virtual bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const = 0;
 
 protected:
     string name_;
     bool verbose_;
     IterCount maxIters_;
     uint32_t numParts_;
+    bool async_;
 
 protected:
     BaseAlgoKernel(const string& name)
-        : name_(name), verbose_(false), maxIters_(INF_ITER_COUNT), numParts_(1)
+        : name_(name), verbose_(false), maxIters_(INF_ITER_COUNT), numParts_(1), async_(false)
     {
         // Nothing else to do.
     }
@@ -150,7 +285,17 @@ protected:
 
 };
 
-template<typename GraphTileType>
+/**
+ * Edge-centric algorithm kernel.
+ *
+ * By default scatter() and gather() are dispatched virtually for each edge and
+ * each update. A kernel can instead pass itself as \c KernelType (CRTP), so
+ * that its scatter() and gather() are resolved at compile time and inlined
+ * into the iteration loops. \c KernelType must then be the most derived
+ * kernel class, and must befriend this class, e.g., <tt>friend
+ * BaseKernelType;</tt>, if scatter() and gather() are not public.
+ */
+template<typename GraphTileType, typename KernelType = void>
 class EdgeCentricAlgoKernel : public BaseAlgoKernel<GraphTileType> {
 public:
     typedef typename GraphTileType::VertexType VertexType;
@@ -190,7 +335,8 @@ protected:
 
 protected:
     using typename BaseAlgoKernel<GraphTileType>::CommSyncType;
-    bool onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const final;
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const final;
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const final;
 
 protected:
     EdgeCentricAlgoKernel(const string& name)
@@ -198,6 +344,44 @@ protected:
     {
         // Nothing else to do.
     }
+
+private:
+    /**
+     * Send phase in asynchronous mode with static scheduling. Repeat scatter
+     * and stream updates to remote tiles, until quiescence.
+     *
+     * Each scatter pass counts as an iteration for scatter() and gather(), so
+     * a pass only scatters the vertices changed since the last pass.
+     */
+    bool onIterationSendStreaming(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const;
+
+    /**
+     * Call scatter() or gather() of \c KernelType without virtual dispatch,
+     * or the virtual ones if \c KernelType is not given.
+     */
+    template<typename K = KernelType>
+    typename std::enable_if<!std::is_void<K>::value, std::pair<UpdateType, bool>>::type
+    scatterDispatch(const IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
+        return static_cast<const K*>(this)->K::scatter(iter, src, weight);
+    }
+
+    template<typename K = KernelType>
+    typename std::enable_if<std::is_void<K>::value, std::pair<UpdateType, bool>>::type
+    scatterDispatch(const IterCount& iter, Ptr<VertexType>& src, EdgeWeightType& weight) const {
+        return scatter(iter, src, weight);
+    }
+
+    template<typename K = KernelType>
+    typename std::enable_if<!std::is_void<K>::value, bool>::type
+    gatherDispatch(const IterCount& iter, Ptr<VertexType>& dst, const UpdateType& update) const {
+        return static_cast<const K*>(this)->K::gather(iter, dst, update);
+    }
+
+    template<typename K = KernelType>
+    typename std::enable_if<std::is_void<K>::value, bool>::type
+    gatherDispatch(const IterCount& iter, Ptr<VertexType>& dst, const UpdateType& update) const {
+        return gather(iter, dst, update);
+    }
 };
 
 template<typename GraphTileType>
@@ -249,7 +433,8 @@ protected:
 
 protected:
     using typename BaseAlgoKernel<GraphTileType>::CommSyncType;
-    bool onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const final;
+    bool onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const final;
+    bool onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const final;
 
 protected:
     VertexCentricAlgoKernel(const string& name)
@@ -261,42 +446,55 @@ protected:
 
 
 
-template<typename GraphTileType>
-bool EdgeCentricAlgoKernel<GraphTileType>::
-onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const {
+template<typename GraphTileType, typename KernelType>
+bool EdgeCentricAlgoKernel<GraphTileType, KernelType>::
+onIterationSend(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const {
 
     const auto tid = graph->tid();
 
-    // As there is no explicit barrier in each iteration, the earliest time
-    // when the producer can know it is safe to reset comm. utility, is at the
-    // beginning of the next iteration after the barrier b/w iterations.
+    // The earliest time when the producer can know it is safe to reset comm.
+    // utility, i.e., all consumers have received, is at the beginning of the
+    // next iteration after the barrier b/w iterations.
     cs.keyValProdDelAll(tid);
 
+    const bool async = this->async();
+    // With static scheduling, each tile is bound to the worker of the same
+    // index, so remote updates can be streamed.
+    if (async && cs.threadCount() == cs.endpointCount()) {
+        return onIterationSendStreaming(graph, cs, iter);
+    }
+    bool converged = true;
+
     // Scatter.
     for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
         const auto srcId = edgeIter->srcId();
         const auto dstId = edgeIter->dstId();
+        const auto dstMirrorIdx = edgeIter->dstMirrorIdx();
         // Return reference to allow update to weight.
         auto& weight = edgeIter->weight();
 
         // Scatter.
         auto src = graph->vertex(srcId);
-        auto ret = scatter(iter, src, weight);
+        auto ret = scatterDispatch(iter, src, weight);
         if (ret.second) {
             const auto& update = ret.first;
-            if (graph->hasVertex(dstId)) {
-                // Local destination.
-                cs.keyValNew(tid, tid, dstId, update);
+            if (dstMirrorIdx == INV_MIRROR_VERTEX_IDX) {
+                if (async) {
+                    // Local destination, gather immediately.
+                    auto dst = graph->vertex(dstId);
+                    converged &= gatherDispatch(iter, dst, update);
+                } else {
+                    // Local destination.
+                    cs.keyValNew(tid, tid, dstId, update);
+                }
             } else {
 #ifdef NO_LOCAL_COMBINE
                 // Remote destination, directly send.
-                const auto mv = graph->mirrorVertex(dstId);
-                const auto dstTileId = mv->masterTileId();
+                const auto dstTileId = graph->mirrorVertexAt(dstMirrorIdx).masterTileId();
                 cs.keyValNew(tid, dstTileId, dstId, update);
 #else // NO_LOCAL_COMBINE
                 // Remote destination, use mirror vertex.
-                auto mv = graph->mirrorVertex(dstId);
-                mv->updateNew(update);
+                graph->mirrorVertexAt(dstMirrorIdx).updateNew(update);
 #endif // NO_LOCAL_COMBINE
             }
         }
@@ -305,26 +503,94 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter)
 #ifdef NO_LOCAL_COMBINE
     // Nothing to do. Already sent directly.
 #else // NO_LOCAL_COMBINE
-    // Send data.
-    for (auto mvIter = graph->mirrorVertexIter(); mvIter != graph->mirrorVertexIterEnd(); ++mvIter) {
-        auto mv = mvIter->second;
-        const auto dstTileId = mv->masterTileId();
-        const auto dstId = mv->vid();
-        if (!mv->hasUpdate()) {
-            // Skip if no update accumulated.
-            continue;
-        }
-        const auto& accUpdate = mv->accUpdate();
-        cs.keyValNew(tid, dstTileId, dstId, accUpdate);
-        // Clear updates in mirror vertex.
-        mv->updateDelAll();
+    // Send data. Only visit the mirror vertices touched in this iteration.
+    for (const auto idx : graph->mirrorVertexDirtyList()) {
+        const auto& mv = graph->mirrorVertexAt(idx);
+        cs.keyValNew(tid, mv.masterTileId(), mv.vid(), mv.accUpdate());
     }
+    // Clear updates in mirror vertices.
+    graph->mirrorVertexDirtyDelAll();
 #endif // NO_LOCAL_COMBINE
 
-    for (uint32_t idx = 0; idx < cs.threadCount(); idx++) {
+    for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
         cs.endTagNew(tid, idx);
     }
 
+    return converged;
+}
+
+template<typename GraphTileType, typename KernelType>
+bool EdgeCentricAlgoKernel<GraphTileType, KernelType>::
+onIterationSendStreaming(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const {
+
+    const auto tid = graph->tid();
+
+    std::vector<typename CommSyncType::KeyValueStream> postStreams(cs.endpointCount());
+    typename CommSyncType::KeyValueStream takeStream;
+
+    // Scatter again if any local vertex has changed since the last scatter.
+    bool rescatter = true;
+    auto pass = iter;
+    while (true) {
+        if (rescatter) {
+            rescatter = false;
+            for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
+                const auto dstMirrorIdx = edgeIter->dstMirrorIdx();
+                auto& weight = edgeIter->weight();
+
+                auto src = graph->vertex(edgeIter->srcId());
+                auto ret = scatterDispatch(pass, src, weight);
+                if (!ret.second) continue;
+                if (dstMirrorIdx == INV_MIRROR_VERTEX_IDX) {
+                    // Local destination, gather immediately.
+                    auto dst = graph->vertex(edgeIter->dstId());
+                    rescatter |= !gatherDispatch(pass, dst, ret.first);
+                } else {
+                    // Remote destination, use mirror vertex.
+                    graph->mirrorVertexAt(dstMirrorIdx).updateNew(ret.first);
+                }
+            }
+
+            // Stream the combined updates of this scatter.
+            for (const auto idx : graph->mirrorVertexDirtyList()) {
+                const auto& mv = graph->mirrorVertexAt(idx);
+                postStreams[mv.masterTileId()].put(typename CommSyncType::KeyValue(mv.vid(), mv.accUpdate()));
+            }
+            graph->mirrorVertexDirtyDelAll();
+            for (uint32_t idx = 0; idx < cs.endpointCount(); idx++) {
+                if (postStreams[idx].size() > 0) cs.keyValPost(idx, postStreams[idx]);
+            }
+            pass++;
+        }
+
+        // Gather the updates streamed from other tiles so far.
+        const auto count = cs.keyValTake(tid, takeStream);
+        for (const auto& u : takeStream) {
+            auto dst = graph->vertex(u.key());
+            // Scattered in the next pass.
+            rescatter |= !gatherDispatch(pass - 1, dst, u.val());
+        }
+        if (count > 0) cs.keyValTakeDone(count);
+
+        if (!rescatter && count == 0) {
+            if (cs.streamQuiescent(tid)) break;
+            std::this_thread::yield();
+        }
+    }
+
+    // Tiles are bound to workers, so can take the barrier.
+    cs.streamEnd(tid);
+
+    // All updates have been applied in all tiles.
+    return true;
+}
+
+template<typename GraphTileType, typename KernelType>
+bool EdgeCentricAlgoKernel<GraphTileType, KernelType>::
+onIterationRecv(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter) const {
+
+    const auto tid = graph->tid();
+
     // Receive data and gather.
     bool converged = true;
     auto hf = std::hash<VertexIdx::Type>();
@@ -332,7 +598,8 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter)
         return hf(k);
     };
     while (true) {
-        auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash);
+        // All tiles have finished sending, no need to sync again.
+        auto recvData = cs.keyValPartitions(tid, this->numParts(), dstIdHash, false);
         const auto& updatePartitions = recvData.first;
         auto recvStatus = recvData.second;
 
@@ -351,7 +618,7 @@ onIteration(Ptr<GraphTileType>& graph, CommSyncType& cs, const IterCount& iter)
 
                 // Gather.
                 auto dst = graph->vertex(dstId);
-                converged &= gather(iter, dst, update);
+                converged &= gatherDispatch(iter, dst, update);
             }
         }
 
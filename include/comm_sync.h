@@ -1,11 +1,73 @@
 #ifndef COMM_SYNC_H_
 #define COMM_SYNC_H_
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 #include "utils/stream.h"
 #include "utils/threads.h"
 
 namespace GraphGASLite {
 
+/*
+ * Combiners for barrier reduction.
+ */
+template<typename T>
+struct SumCombiner {
+    T operator()(const T& a, const T& b) const { return a + b; }
+};
+
+template<typename T>
+struct MinCombiner {
+    T operator()(const T& a, const T& b) const { return b < a ? b : a; }
+};
+
+template<typename T>
+struct MaxCombiner {
+    T operator()(const T& a, const T& b) const { return a < b ? b : a; }
+};
+
+struct ANDCombiner {
+    bool operator()(const bool a, const bool b) const { return a && b; }
+};
+
+struct ORCombiner {
+    bool operator()(const bool a, const bool b) const { return a || b; }
+};
+
+/**
+ * Combine tuples element-wise, each element with its own combiner. Used to
+ * fuse multiple reductions into a single barrier.
+ */
+template<typename... Combiners>
+struct TupleCombiner {
+    template<typename... Ts>
+    std::tuple<Ts...> operator()(const std::tuple<Ts...>& a, const std::tuple<Ts...>& b) const {
+        static_assert(sizeof...(Ts) == sizeof...(Combiners), "TupleCombiner: size mismatch.");
+        std::tuple<Ts...> ret;
+        combine<0>(ret, a, b);
+        return ret;
+    }
+
+private:
+    std::tuple<Combiners...> combiners_;
+
+    template<size_t I, typename Tuple>
+    typename std::enable_if<I < std::tuple_size<Tuple>::value, void>::type
+    combine(Tuple& ret, const Tuple& a, const Tuple& b) const {
+        std::get<I>(ret) = std::get<I>(combiners_)(std::get<I>(a), std::get<I>(b));
+        combine<I+1>(ret, a, b);
+    }
+
+    template<size_t I, typename Tuple>
+    typename std::enable_if<I >= std::tuple_size<Tuple>::value, void>::type
+    combine(Tuple&, const Tuple&, const Tuple&) const { }
+};
+
 template<typename KType, typename VType>
 class CommSync {
 public:
@@ -43,14 +105,36 @@ public:
         RECV_FINISHED,
     };
 
+    enum BarrierType {
+        // Mutex and condition variable based barrier.
+        BARRIER_BLOCKING,
+        // Sense-reversing combining tree barrier, spinning before parking.
+        BARRIER_SPIN_TREE,
+    };
+
     typedef Stream<KeyValue> KeyValueStream;
 
+    /**
+     * The bulk buffer type used to exchange arrays of words between
+     * endpoints, e.g., adjacency lists, without per-element keys.
+     */
+    typedef std::vector<uint64_t> BulkBuffer;
+
     // Reserve at most 4k or 256 key-value pairs for each prod-cons pair.
     static constexpr size_t reservedStreamSize = 4096/sizeof(KeyValue) < 256 ?
         4096/sizeof(KeyValue) : 256;
 
 public:
-    explicit CommSync(const uint32_t threadCount, const KeyValue& endTag);
+    /**
+     * @param threadCount       Number of threads taking part in barriers.
+     * @param endTag            End-of-message tag.
+     * @param barrierType       Barrier type.
+     * @param endpointCount     Number of communication endpoints, e.g., graph
+     *                          tiles, which can be more than threads. Default
+     *                          to one endpoint per thread.
+     */
+    explicit CommSync(const uint32_t threadCount, const KeyValue& endTag,
+            const BarrierType barrierType = BARRIER_SPIN_TREE, const uint32_t endpointCount = 0);
 
     ~CommSync();
 
@@ -59,6 +143,16 @@ public:
      */
     uint32_t threadCount() const { return threadCount_; }
 
+    /**
+     * Number of communication endpoints.
+     */
+    uint32_t endpointCount() const { return endpointCount_; }
+
+    /**
+     * Barrier type.
+     */
+    BarrierType barrierType() const { return barrierType_; }
+
     /**
      * Thread register.
      */
@@ -74,6 +168,17 @@ public:
      */
     bool barrierAND(const uint32_t threadId, bool input);
 
+    /**
+     * Synchronization barrier, also do a reduction of \c input from all
+     * threads using \c combiner. All threads must use the same combiner.
+     *
+     * Inputs are combined in the order of thread index, so the result is
+     * deterministic. Use a tuple of values with TupleCombiner to fuse multiple
+     * reductions into one barrier.
+     */
+    template<typename Combiner, typename T>
+    T barrierReduce(const uint32_t threadId, const T& input, const Combiner& combiner = Combiner());
+
     /**
      * Send a key-value pair from \c prodId to \c consId.
      */
@@ -97,31 +202,113 @@ public:
      */
     void keyValConsDelAll(const uint32_t consId);
 
+    /**
+     * Re-allocate all streams to \c consId on the calling thread, so they are
+     * placed on the NUMA node of the consumer by first touch.
+     *
+     * Must not be called concurrently with communication to \c consId.
+     */
+    void keyValConsRealloc(const uint32_t consId);
+
     /**
      * Receive all key-value pairs available now, and partition them into subpartitions.
      *
-     * @param consId            Thread index of the consumer.
+     * @param consId            Endpoint index of the consumer.
      * @param partitionCount    Number of subpartitions.
      * @param partitionFunc     Partition function. For a key \c k, partition index
      *                          is calculated as <tt>partitionFunc(k) % partitionCount</tt>.
+     * @param sync              Whether to take a barrier first, with \c consId as
+     *                          the thread index. Pass false if the caller has
+     *                          already synchronized with all producers.
      *
      * @return      A pair consisting of the subpartitions, and the receiving status.
      */
     std::pair<std::vector<KeyValueStream>, RecvStatusType> keyValPartitions(
             const uint32_t consId, const size_t partitionCount,
-            std::function<size_t(const KeyType&)> partitionFunc);
+            std::function<size_t(const KeyType&)> partitionFunc, const bool sync = true);
+
+    /**
+     * Append \c count words to the bulk buffer from \c prodId to \c consId.
+     */
+    void bulkNew(const uint32_t prodId, const uint32_t consId, const uint64_t* data, const size_t count);
+    void bulkNew(const uint32_t prodId, const uint32_t consId, const uint64_t word) {
+        bulkNew(prodId, consId, &word, 1);
+    }
+
+    /**
+     * Bulk buffer from \c prodId to \c consId.
+     *
+     * Must be synchronized with the producer, e.g., by a barrier, before
+     * reading.
+     */
+    const BulkBuffer& bulk(const uint32_t prodId, const uint32_t consId) const {
+        return bulkLists_[prodId][consId];
+    }
+
+    /**
+     * Delete all bulk buffers to \c consId at consumer side after
+     * communication is done.
+     */
+    void bulkConsDelAll(const uint32_t consId);
+
+    /**
+     * Streaming delivery, where key-value pairs are received in the middle of
+     * a phase, and the phase ends at global quiescence. Only used when each
+     * endpoint is bound to the thread with the same index.
+     *
+     * Each thread repeatedly posts, takes, and marks the taken pairs as done
+     * once processed. A thread with no more work calls streamQuiescent(),
+     * which marks it idle until it takes new pairs, and returns true once all
+     * threads are idle and all posted pairs are done. Then all threads call
+     * streamEnd() to finish the phase.
+     */
+
+    /**
+     * Post all key-value pairs in \c s to \c consId, and clear \c s.
+     * Thread-safe.
+     */
+    void keyValPost(const uint32_t consId, KeyValueStream& s);
+
+    /**
+     * Take all key-value pairs posted to \c consId so far into \c s, and
+     * return their count. Must be called by thread \c consId.
+     */
+    size_t keyValTake(const uint32_t consId, KeyValueStream& s);
+
+    /**
+     * Mark \c count taken key-value pairs as processed.
+     */
+    void keyValTakeDone(const size_t count);
+
+    /**
+     * Mark thread \c threadId as idle, and check if all threads are idle with
+     * no key-value pairs in flight.
+     */
+    bool streamQuiescent(const uint32_t threadId);
+
+    /**
+     * Finish the streaming phase and reset the quiescence detection. Takes a
+     * barrier.
+     */
+    void streamEnd(const uint32_t threadId);
 
 private:
     const uint32_t threadCount_;
+    const uint32_t endpointCount_;
 
     /* Synchronization. */
 
     // Barrier.
+    const BarrierType barrierType_;
     bar_t bar_;
+    tree_bar_t treeBar_;
 
-    // Used for barrierAND.
-    bool barANDCurReduction_;
-    bool barANDLastResult_;
+    // Used for barrierReduce. Each thread puts the pointer to its input,
+    // which is alive until it leaves the barrier.
+    std::vector<const void*> reduceInputs_;
+    // Result of the last reduction, constructed in place without allocation.
+    static constexpr size_t reduceResultSize = 128;
+    alignas(alignof(std::max_align_t)) unsigned char reduceResult_[reduceResultSize];
 
     /* Communication. */
 
@@ -131,31 +318,73 @@ private:
     const KeyValue endTag_;
 
     /**
-     * Each producer thread is associated with multiple streams, each of which
-     * is for a consumer thread.
+     * Each producer endpoint is associated with multiple streams, each of which
+     * is for a consumer endpoint.
      *
      * Indexed by [prodId][consId].
      */
     std::vector<std::vector<KeyValueStream>> streamLists_;
 
+    /**
+     * Bulk buffers, indexed by [prodId][consId]. Memory is only allocated
+     * when used.
+     */
+    std::vector<std::vector<BulkBuffer>> bulkLists_;
+
+    /**
+     * Streaming mailboxes, indexed by consId.
+     */
+    struct Mailbox {
+        lock_t lock;
+        KeyValueStream stream;
+    };
+    std::vector<Mailbox> mailboxes_;
+
+    /**
+     * Quiescence detection of streaming delivery. A thread is activated when
+     * it takes pairs while idle. All threads are idle with nothing in flight
+     * if the idle count is full, and no thread is activated between reading
+     * the activation count before it and reading the post and done counts
+     * after it.
+     */
+    std::vector<uint8_t> idle_;
+    std::atomic<uint32_t> idleCount_;
+    std::atomic<uint64_t> activationCount_;
+    std::atomic<uint64_t> postCount_;
+    std::atomic<uint64_t> takeDoneCount_;
+    std::atomic<bool> quiescent_;
+
+private:
+    /**
+     * Wait on the selected barrier, and call \c onSerialPoint at the serial point.
+     */
+    void barrierWait(const uint32_t threadId, const std::function<void(void)>& onSerialPoint);
+
 };
 
 template<typename KType, typename VType>
 constexpr size_t CommSync<KType, VType>::reservedStreamSize;
 
+template<typename KType, typename VType>
+constexpr size_t CommSync<KType, VType>::reduceResultSize;
+
 
 
 template<typename KType, typename VType>
 CommSync<KType, VType>::
-CommSync(const uint32_t threadCount, const KeyValue& endTag)
-    : threadCount_(threadCount),
-      bar_(threadCount), barANDCurReduction_(true), barANDLastResult_(false),
-      endTag_(endTag)
+CommSync(const uint32_t threadCount, const KeyValue& endTag, const BarrierType barrierType,
+        const uint32_t endpointCount)
+    : threadCount_(threadCount), endpointCount_(endpointCount ? endpointCount : threadCount),
+      barrierType_(barrierType), bar_(threadCount), treeBar_(threadCount),
+      reduceInputs_(threadCount, nullptr),
+      endTag_(endTag), bulkLists_(endpointCount_, std::vector<BulkBuffer>(endpointCount_)),
+      mailboxes_(endpointCount_), idle_(threadCount, 0), idleCount_(0), activationCount_(0),
+      postCount_(0), takeDoneCount_(0), quiescent_(false)
 {
     // Initialize communication streams.
-    streamLists_.resize(threadCount_);
+    streamLists_.resize(endpointCount_);
     for (auto& sl : streamLists_) {
-        sl.resize(threadCount_);
+        sl.resize(endpointCount_);
         for (auto& s : sl) {
             s.reset(reservedStreamSize);
         }
@@ -176,20 +405,45 @@ threadIdIs(const uint32_t) {
 
 template<typename KType, typename VType>
 void CommSync<KType, VType>::
-barrier(const uint32_t) {
-    bar_.wait();
+barrier(const uint32_t threadId) {
+    barrierWait(threadId, nullptr);
 }
 
 template<typename KType, typename VType>
 bool CommSync<KType, VType>::
-barrierAND(const uint32_t, bool input) {
-    barANDCurReduction_ &= input;
-    auto scb = [this](){
-        barANDLastResult_ = barANDCurReduction_;
-        barANDCurReduction_ = true;
+barrierAND(const uint32_t threadId, bool input) {
+    return barrierReduce(threadId, input, ANDCombiner());
+}
+
+template<typename KType, typename VType>
+template<typename Combiner, typename T>
+T CommSync<KType, VType>::
+barrierReduce(const uint32_t threadId, const T& input, const Combiner& combiner) {
+    static_assert(sizeof(T) <= reduceResultSize && alignof(T) <= alignof(std::max_align_t),
+            "CommSync: reduction type does not fit the result storage.");
+    static_assert(std::is_trivially_destructible<T>::value,
+            "CommSync: reduction type must be trivially destructible.");
+    reduceInputs_[threadId] = &input;
+    auto scb = [this, &combiner](){
+        T acc = *static_cast<const T*>(reduceInputs_[0]);
+        for (uint32_t idx = 1; idx < threadCount_; idx++) {
+            acc = combiner(acc, *static_cast<const T*>(reduceInputs_[idx]));
+        }
+        // The last result has been read by all threads before arriving.
+        new (reduceResult_) T(acc);
     };
-    bar_.wait(scb);
-    return barANDLastResult_;
+    barrierWait(threadId, scb);
+    return *reinterpret_cast<const T*>(reduceResult_);
+}
+
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+barrierWait(const uint32_t threadId, const std::function<void(void)>& onSerialPoint) {
+    if (barrierType_ == BARRIER_SPIN_TREE) {
+        treeBar_.wait(threadId, onSerialPoint);
+    } else {
+        bar_.wait(onSerialPoint);
+    }
 }
 
 template<typename KType, typename VType>
@@ -221,16 +475,24 @@ keyValConsDelAll(const uint32_t consId) {
     }
 }
 
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+keyValConsRealloc(const uint32_t consId) {
+    for (auto& sl : streamLists_) {
+        sl[consId].realloc();
+    }
+}
+
 template<typename KType, typename VType>
 std::pair<std::vector<typename CommSync<KType, VType>::KeyValueStream>,
     typename CommSync<KType, VType>::RecvStatusType> CommSync<KType, VType>::
 keyValPartitions(const uint32_t consId, const size_t partitionCount,
-        std::function<size_t(const KeyType&)> partitionFunc) {
+        std::function<size_t(const KeyType&)> partitionFunc, const bool sync) {
 
     std::vector<KeyValueStream> prtns(partitionCount);
 
     // Take barrier to ensure all threads have finished sending all data.
-    barrier(consId);
+    if (sync) barrier(consId);
 
     // Local stream.
     if (partitionCount == 1) {
@@ -243,7 +505,7 @@ keyValPartitions(const uint32_t consId, const size_t partitionCount,
     }
 
     // Remote streams.
-    for (uint32_t prodId = 0; prodId < threadCount_; prodId++) {
+    for (uint32_t prodId = 0; prodId < endpointCount_; prodId++) {
         // Skip local stream.
         if (prodId == consId) continue;
 
@@ -256,6 +518,87 @@ keyValPartitions(const uint32_t consId, const size_t partitionCount,
     return std::make_pair(std::move(prtns), RECV_FINISHED);
 }
 
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+bulkNew(const uint32_t prodId, const uint32_t consId, const uint64_t* data, const size_t count) {
+    auto& buf = bulkLists_[prodId][consId];
+    buf.insert(buf.end(), data, data + count);
+}
+
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+bulkConsDelAll(const uint32_t consId) {
+    for (auto& bl : bulkLists_) {
+        // Release the memory, bulk exchanges are usually one-off.
+        BulkBuffer().swap(bl[consId]);
+    }
+}
+
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+keyValPost(const uint32_t consId, KeyValueStream& s) {
+    // Count before delivery, so the pairs are in flight until done.
+    postCount_ += s.size();
+    auto& mb = mailboxes_[consId];
+    mutex_begin(uqlk, mb.lock);
+    for (const auto& kv : s) mb.stream.put(kv);
+    mutex_end();
+    s.reset(std::max<size_t>(s.size(), reservedStreamSize));
+}
+
+template<typename KType, typename VType>
+size_t CommSync<KType, VType>::
+keyValTake(const uint32_t consId, KeyValueStream& s) {
+    s.reset(std::max<size_t>(s.size(), reservedStreamSize));
+    auto& mb = mailboxes_[consId];
+    mutex_begin(uqlk, mb.lock);
+    mb.stream.swap(s);
+    mutex_end();
+    if (s.size() > 0 && idle_[consId]) {
+        activationCount_++;
+        idle_[consId] = 0;
+        idleCount_--;
+    }
+    return s.size();
+}
+
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+keyValTakeDone(const size_t count) {
+    takeDoneCount_ += count;
+}
+
+template<typename KType, typename VType>
+bool CommSync<KType, VType>::
+streamQuiescent(const uint32_t threadId) {
+    if (!idle_[threadId]) {
+        idle_[threadId] = 1;
+        idleCount_++;
+    }
+    if (quiescent_) return true;
+
+    const auto activationCount = activationCount_.load();
+    if (idleCount_ != threadCount_) return false;
+    // Done count is read first, as it never exceeds the post count.
+    const auto takeDoneCount = takeDoneCount_.load();
+    const auto postCount = postCount_.load();
+    if (activationCount_ != activationCount || takeDoneCount != postCount) return false;
+
+    quiescent_ = true;
+    return true;
+}
+
+template<typename KType, typename VType>
+void CommSync<KType, VType>::
+streamEnd(const uint32_t threadId) {
+    auto scb = [this](){
+        std::fill(idle_.begin(), idle_.end(), 0);
+        idleCount_ = 0;
+        quiescent_ = false;
+    };
+    barrierWait(threadId, scb);
+}
+
 } // namespace GraphGASLite
 
 #endif // COMM_SYNC_H_
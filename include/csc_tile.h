@@ -0,0 +1,143 @@
+#ifndef CSC_TILE_H_
+#define CSC_TILE_H_
+
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "graph.h"
+
+namespace GraphGASLite {
+
+/**
+ * Compressed sparse column (in-edge) view of a finalized graph tile.
+ *
+ * Local vertices are densely indexed in [0, vertexCount()). The edge targets
+ * are the local vertices followed by the mirror vertices, i.e., target
+ * <tt>vertexCount() + i</tt> is the mirror vertex with dense index \c i in the
+ * tile. The sources of the edges to each target are stored contiguously, as
+ * dense indices of local vertices. The out-edges of each local vertex are
+ * also stored contiguously, as targets in the order of the tile edges.
+ *
+ * Kernels can keep per-vertex values in dense arrays indexed the same way, and
+ * pull over the in-edges of each target, or push over the out-edges of each
+ * vertex, without hash lookups.
+ *
+ * The view does not track later changes of the tile.
+ */
+template<typename GraphTileType>
+class CSCTile {
+public:
+    typedef typename GraphTileType::VertexType VertexType;
+
+    explicit CSCTile(const Ptr<GraphTileType>& graph) {
+        if (!graph->finalized()) {
+            throw PermissionException(string(__func__) + ": Graph tile has not been finalized.");
+        }
+
+        vertices_.reserve(graph->vertexCount());
+        vertexIdxs_.reserve(graph->vertexCount());
+        for (auto vertexIter = graph->vertexIter(); vertexIter != graph->vertexIterEnd(); ++vertexIter) {
+            vertexIdxs_[vertexIter->first] = vertices_.size();
+            vertices_.push_back(vertexIter->second);
+        }
+
+        const auto vertexCount = vertices_.size();
+        const auto targetCount = vertexCount + graph->mirrorVertexCount();
+
+        // Counting sort the edges by target, and by source.
+        inEdgeOffsets_.assign(targetCount + 1, 0);
+        outEdgeOffsets_.assign(vertexCount + 1, 0);
+        std::vector<uint32_t> edgeSrcs;
+        std::vector<uint32_t> edgeTargets;
+        edgeSrcs.reserve(graph->edgeCount());
+        edgeTargets.reserve(graph->edgeCount());
+        for (auto edgeIter = graph->edgeIter(); edgeIter != graph->edgeIterEnd(); ++edgeIter) {
+            const auto dstMirrorIdx = edgeIter->dstMirrorIdx();
+            const uint32_t target = (dstMirrorIdx == INV_MIRROR_VERTEX_IDX)
+                ? vertexIdxs_.at(edgeIter->dstId()) : vertexCount + dstMirrorIdx;
+            const uint32_t src = vertexIdxs_.at(edgeIter->srcId());
+            edgeSrcs.push_back(src);
+            edgeTargets.push_back(target);
+            inEdgeOffsets_[target + 1]++;
+            outEdgeOffsets_[src + 1]++;
+        }
+        for (size_t t = 0; t < targetCount; t++) {
+            inEdgeOffsets_[t + 1] += inEdgeOffsets_[t];
+        }
+        for (size_t idx = 0; idx < vertexCount; idx++) {
+            outEdgeOffsets_[idx + 1] += outEdgeOffsets_[idx];
+        }
+
+        inEdgeSrcs_.resize(graph->edgeCount());
+        outEdgeTargets_.resize(graph->edgeCount());
+        std::vector<size_t> inPos(inEdgeOffsets_.begin(), inEdgeOffsets_.end() - 1);
+        std::vector<size_t> outPos(outEdgeOffsets_.begin(), outEdgeOffsets_.end() - 1);
+        for (size_t edgeIdx = 0; edgeIdx < edgeSrcs.size(); edgeIdx++) {
+            inEdgeSrcs_[inPos[edgeTargets[edgeIdx]]++] = edgeSrcs[edgeIdx];
+            outEdgeTargets_[outPos[edgeSrcs[edgeIdx]]++] = edgeTargets[edgeIdx];
+        }
+    }
+
+    /**
+     * Number of local vertices.
+     */
+    uint32_t vertexCount() const { return vertices_.size(); }
+
+    /**
+     * Number of edge targets, local vertices followed by mirror vertices.
+     */
+    uint32_t targetCount() const { return inEdgeOffsets_.size() - 1; }
+
+    /**
+     * Local vertex by dense index.
+     */
+    const Ptr<VertexType>& vertexAt(const uint32_t idx) const {
+        return vertices_[idx];
+    }
+
+    /**
+     * Dense index of local vertex \c vid.
+     */
+    uint32_t vertexIdx(const VertexIdx& vid) const {
+        auto it = vertexIdxs_.find(vid);
+        if (it == vertexIdxs_.end()) {
+            throw RangeException(std::to_string(vid));
+        }
+        return it->second;
+    }
+
+    /**
+     * In-edges of target \c t are <tt>[inEdgeOffsets()[t], inEdgeOffsets()[t+1])</tt>
+     * in inEdgeSrcs().
+     */
+    const std::vector<size_t>& inEdgeOffsets() const { return inEdgeOffsets_; }
+
+    /**
+     * Dense indices of the source vertices of in-edges, grouped by target.
+     */
+    const std::vector<uint32_t>& inEdgeSrcs() const { return inEdgeSrcs_; }
+
+    /**
+     * Out-edges of local vertex \c idx are <tt>[outEdgeOffsets()[idx], outEdgeOffsets()[idx+1])</tt>
+     * in outEdgeTargets().
+     */
+    const std::vector<size_t>& outEdgeOffsets() const { return outEdgeOffsets_; }
+
+    /**
+     * Targets of out-edges, grouped by source vertex.
+     */
+    const std::vector<uint32_t>& outEdgeTargets() const { return outEdgeTargets_; }
+
+private:
+    std::vector< Ptr<VertexType> > vertices_;
+    std::unordered_map< VertexIdx, uint32_t, std::hash<VertexIdx::Type> > vertexIdxs_;
+
+    std::vector<size_t> inEdgeOffsets_;
+    std::vector<uint32_t> inEdgeSrcs_;
+    std::vector<size_t> outEdgeOffsets_;
+    std::vector<uint32_t> outEdgeTargets_;
+};
+
+} // namespace GraphGASLite
+
+#endif // CSC_TILE_H_
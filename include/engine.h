@@ -8,6 +8,7 @@
 #include "algo_kernel.h"
 #include "comm_sync.h"
 #include "graph.h"
+#include "tile_scheduler.h"
 
 namespace GraphGASLite {
 
@@ -16,12 +17,21 @@ class Engine {
 public:
     typedef BaseAlgoKernel<GraphTileType> AlgoKernelType;
 
-    typedef std::vector< Ptr<GraphTileType> > GraphTileList;
+    typedef typename AlgoKernelType::GraphTileList GraphTileList;
 
     typedef std::vector< Ptr<const AlgoKernelType> > AlgoKernelList;
     typedef typename AlgoKernelList::iterator AlgoKernelIter;
     typedef typename AlgoKernelList::const_iterator AlgoKernelConstIter;
 
+    enum AffinityType {
+        // No CPU pinning.
+        AFFINITY_NONE,
+        // Pin each worker to a single CPU.
+        AFFINITY_CORE,
+        // Pin each worker to all CPUs of a socket.
+        AFFINITY_SOCKET,
+    };
+
 public:
     Ptr<GraphTileType> graphTile(const TileIdx& tid) const {
         if (tid >= graphs_.size()) return nullptr;
@@ -44,6 +54,7 @@ public:
             throw InvalidArgumentException("graphTile");
         }
         graphs_.push_back(graphTile);
+        runtimeDel();
     }
     /**
      * Copy-assign all graph tiles.
@@ -61,6 +72,7 @@ public:
             }
         }
         graphs_ = graphs;
+        runtimeDel();
     }
     /**
      * Move-assign all graph tiles.
@@ -78,6 +90,39 @@ public:
             }
         }
         graphs_.swap(graphs);
+        runtimeDel();
+    }
+
+    /**
+     * Number of worker threads.
+     *
+     * Default 0 means one worker for each tile. If fewer than the graph tiles,
+     * the workers dynamically claim tiles in each phase of the iterations,
+     * their home tiles first, and then the remaining larger tiles first.
+     */
+    size_t workerCount() const {
+        return workerCount_;
+    }
+    void workerCountIs(const size_t workerCount) {
+        if (workerCount != workerCount_) runtimeDel();
+        workerCount_ = workerCount;
+    }
+
+    /**
+     * Worker thread affinity.
+     *
+     * Workers are distributed to sockets round-robin. With CPU pinning, each
+     * worker also re-allocates its home tiles and their incoming streams
+     * before running, so they are placed on its NUMA node by first touch.
+     * Tile \c t is at home on worker <tt>t % workerCount</tt>, which also
+     * claims it first with dynamic scheduling.
+     */
+    AffinityType affinity() const {
+        return affinity_;
+    }
+    void affinityIs(const AffinityType affinity) {
+        if (affinity != affinity_) runtimeDel();
+        affinity_ = affinity;
     }
 
     size_t algoKernelCount() const {
@@ -115,59 +160,137 @@ public:
      * Run all algorithm kernels in sequence on the graph tiles.
      *
      * The engine is defined as a functor class.
+     *
+     * The worker threads, communication buffers and tile scheduler are kept
+     * between calls, so repeated runs on the same graph, e.g., queries from
+     * different sources, only pay the computation cost. They are rebuilt when
+     * the graph tiles, the worker count or the affinity changes.
      */
     void operator()() {
-        // Number of worker threads.
-        // Currently use one thread for each tile.
-        auto threadCount = graphTileCount();
-
-        // Utility for communication and synchronization.
-        typedef CommSync<VertexIdx, typename GraphTileType::UpdateType> CommSyncType;
-        CommSyncType cs(threadCount,
-                typename CommSyncType::KeyValue(-1uL, typename GraphTileType::UpdateType()));
-
-        // Construct thread input data.
-        struct ThreadData {
-            Ptr<GraphTileType> graphTile_;
-            AlgoKernelList kernels_;
-            CommSyncType* cs_;
-        };
-        std::vector<ThreadData> threadData;
-        for (auto graphTile : graphs_) {
-            // Clone the algorithm kernels for each worker.
-            AlgoKernelList kernels;
-            for (auto k : kernels_) {
-                kernels.push_back(k);
-            }
-            threadData.push_back({graphTile, kernels, &cs});
+        if (graphTileCount() == 0) return;
+
+        if (runtime_ == nullptr) runtimeNew();
+        auto& rt = *runtime_;
+
+        // Update the algorithm kernels for each worker.
+        for (auto& td : rt.threadData_) {
+            td.kernels_ = kernels_;
         }
 
         // Thread function.
-        auto threadRegisterFunc = [](ThreadData& td) {
-            td.cs_->threadIdIs(td.graphTile_->tid());
-        };
-        auto threadFunc = [](ThreadData& td) {
+        auto threadFunc = [this](ThreadData& td) {
+            // Pool threads are only bound to workers while running this task,
+            // so pin here rather than at registration. The start barrier of
+            // the kernel waits for all workers.
+            threadPin(td);
             for (auto& k : td.kernels_) {
-                (*k)(td.graphTile_, *td.cs_);
+                (*k)(graphs_, *runtime_->cs_, *runtime_->sched_, td.workerId_);
             }
         };
 
-        // Thread pool.
-        auto pool = new ThreadPool(threadCount);
-        for (auto& td : threadData) {
-            pool->add_task(std::bind(threadRegisterFunc, td));
-        }
-        pool->wait_all();
-        for (auto& td : threadData) {
-            pool->add_task(std::bind(threadFunc, td));
+        // Capture by reference, so the tasks are stored inline.
+        for (auto& td : rt.threadData_) {
+            rt.pool_->add_task([&threadFunc, &td]{ threadFunc(td); });
         }
-        pool->wait_all();
-        delete pool;
+        rt.pool_->wait_all();
     }
 
 private:
+    // Utility for communication and synchronization.
+    // Communicate b/w tiles, and synchronize b/w workers.
+    typedef CommSync<VertexIdx, typename GraphTileType::UpdateType> CommSyncType;
+
+    // Thread input data.
+    struct ThreadData {
+        uint32_t workerId_;
+        AlgoKernelList kernels_;
+        // If home tiles have been re-allocated on the local node.
+        bool localized_;
+    };
+
+    // Runtime kept between runs.
+    struct Runtime {
+        Ptr<ThreadPool> pool_;
+        Ptr<CommSyncType> cs_;
+        Ptr<TileScheduler> sched_;
+        std::vector<ThreadData> threadData_;
+        std::vector<std::vector<int>> sockets_;
+    };
+
     GraphTileList graphs_;
     AlgoKernelList kernels_;
+    size_t workerCount_ = 0;
+    AffinityType affinity_ = AFFINITY_NONE;
+
+    Ptr<Runtime> runtime_;
+
+private:
+    void runtimeNew() {
+        // Number of worker threads.
+        auto tileCount = graphTileCount();
+        auto threadCount = (workerCount_ == 0) ? tileCount : std::min(workerCount_, tileCount);
+
+        Ptr<Runtime> rt(new Runtime());
+
+        rt->cs_.reset(new CommSyncType(threadCount,
+                    typename CommSyncType::KeyValue(-1uL, typename GraphTileType::UpdateType()),
+                    CommSyncType::BARRIER_SPIN_TREE, tileCount));
+
+        // Tile scheduler, claim home tiles, and then the remaining larger
+        // tiles first.
+        rt->sched_.reset(new TileScheduler(tileCount, threadCount));
+        if (rt->sched_->dynamic()) {
+            std::vector<uint32_t> order(tileCount);
+            for (uint32_t idx = 0; idx < tileCount; idx++) order[idx] = idx;
+            std::stable_sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) {
+                return graphs_[a]->edgeCount() > graphs_[b]->edgeCount();
+            });
+            rt->sched_->tileOrderIs(order);
+        }
+
+        for (uint32_t workerId = 0; workerId < threadCount; workerId++) {
+            rt->threadData_.push_back({workerId, AlgoKernelList(), false});
+        }
+
+        if (affinity_ != AFFINITY_NONE) rt->sockets_ = cpu_sockets();
+
+        // Thread pool.
+        rt->pool_.reset(new ThreadPool(threadCount));
+        auto& cs = *rt->cs_;
+        for (auto& td : rt->threadData_) {
+            rt->pool_->add_task([&cs, &td]{ cs.threadIdIs(td.workerId_); });
+        }
+        rt->pool_->wait_all();
+
+        runtime_ = rt;
+    }
+
+    void runtimeDel() {
+        runtime_ = nullptr;
+    }
+
+    /**
+     * Pin the calling thread for worker \c td, and first touch its home tiles
+     * on the local node if not yet.
+     */
+    void threadPin(ThreadData& td) {
+        const auto& sockets = runtime_->sockets_;
+        if (affinity_ == AFFINITY_NONE || sockets.empty()) return;
+        const auto& socket = sockets[td.workerId_ % sockets.size()];
+        if (affinity_ == AFFINITY_CORE) {
+            thread_affinity_set({socket[(td.workerId_ / sockets.size()) % socket.size()]});
+        } else {
+            thread_affinity_set(socket);
+        }
+        if (td.localized_) return;
+        // First touch home tiles on the local node.
+        const auto threadCount = runtime_->threadData_.size();
+        for (size_t tid = td.workerId_; tid < graphs_.size(); tid += threadCount) {
+            graphs_[tid]->reallocLocal();
+            runtime_->cs_->keyValConsRealloc(tid);
+        }
+        td.localized_ = true;
+    }
 
 };
 
@@ -2,6 +2,7 @@
 #define GRAPH_H_
 
 #include <algorithm>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 #include "common.h"
@@ -20,6 +21,16 @@ typedef IndexType<uint64_t, TileIdxRepType> TileIdx;
 class DegreeRepType;
 typedef CountType<uint32_t, DegreeRepType> DegreeCount;
 
+class MirrorVertexIdxRepType;
+typedef IndexType<uint32_t, MirrorVertexIdxRepType> MirrorVertexIdx;
+
+/**
+ * Invalid mirror vertex index, used by edges whose destination is local.
+ */
+static constexpr auto INV_MIRROR_VERTEX_IDX = std::numeric_limits<typename MirrorVertexIdx::Type>::max();
+
+typedef std::vector<MirrorVertexIdx> MirrorVertexIdxList;
+
 template<typename VertexDataType, typename UpdateDataType, typename EdgeWeightType>
 class GraphTile;
 
@@ -60,7 +71,8 @@ private:
         // Nothing else to do.
     }
 
-    Vertex(const Vertex&) = delete;
+    // Only used by GraphTile to re-allocate vertices.
+    Vertex(const Vertex&) = default;
     Vertex& operator=(const Vertex&) = delete;
     Vertex(Vertex&&) = delete;
     Vertex& operator=(Vertex&&) = delete;
@@ -78,24 +90,20 @@ public:
 
     bool hasUpdate() const { return hasUpdate_; }
 
-    UpdateType accUpdate() const { return accUpdate_; }
+    const UpdateType& accUpdate() const { return accUpdate_; }
 
     /**
      * Add a new update, i.e., merge into accUpdate.
+     *
+     * The first update after reset records this mirror vertex in the dirty
+     * list of its tile.
      */
     void updateNew(const UpdateType& update) {
+        if (!hasUpdate_) dirtyList_->push_back(idx_);
         accUpdate_ += update;
         hasUpdate_ = true;
     }
 
-    /**
-     * Delete all updates, i.e., reset accUpdate.
-     */
-    void updateDelAll() {
-        accUpdate_ = UpdateType();
-        hasUpdate_ = false;
-    }
-
     /**
      * When sync vertex degree with other tiles, clear the mirror vertex
      * acc degree after propagating to master vertex.
@@ -106,8 +114,14 @@ public:
     }
 
 private:
-    const VertexIdx vid_;
-    const TileIdx masterTileId_;
+    VertexIdx vid_;
+    TileIdx masterTileId_;
+
+    // Index in the dense mirror vertex array of the tile.
+    MirrorVertexIdx idx_;
+
+    // Dirty list of the tile.
+    MirrorVertexIdxList* dirtyList_;
 
     bool hasUpdate_;
 
@@ -121,8 +135,9 @@ private:
     template<typename VDT, typename UDT, typename EWT>
     friend class GraphTile;
 
-    MirrorVertex(const VertexIdx& vid, const TileIdx& masterTileId)
-        : vid_(vid), masterTileId_(masterTileId), accDeg_(0)
+    MirrorVertex(const VertexIdx& vid, const TileIdx& masterTileId, const MirrorVertexIdx& idx,
+            MirrorVertexIdxList* const dirtyList)
+        : vid_(vid), masterTileId_(masterTileId), idx_(idx), dirtyList_(dirtyList), accDeg_(0)
           // accUpdate_ initialized after accDeg_ is used.
     {
         // Nothing else to do.
@@ -132,11 +147,30 @@ private:
         accDeg_ += d;
     }
 
+    /**
+     * Delete all updates, i.e., reset accUpdate.
+     *
+     * Only called by the tile, which also clears the dirty list, see
+     * GraphTile::mirrorVertexDirtyDelAll(). Otherwise the next update would
+     * record this mirror vertex in the dirty list again, and it would be sent
+     * twice.
+     */
+    void updateDelAll() {
+        accUpdate_ = UpdateType();
+        hasUpdate_ = false;
+    }
+
     MirrorVertex(const MirrorVertex&) = delete;
     MirrorVertex& operator=(const MirrorVertex&) = delete;
-    MirrorVertex(MirrorVertex&&) = delete;
-    MirrorVertex& operator=(MirrorVertex&&) = delete;
     bool operator==(const MirrorVertex&) const = delete;
+
+public:
+    /**
+     * Move-assignable and move-constructible, to be stored by value in the
+     * dense mirror vertex array of the tile, and sorted.
+     */
+    MirrorVertex(MirrorVertex&&) = default;
+    MirrorVertex& operator=(MirrorVertex&&) = default;
 };
 
 template<typename EdgeWeightType = uint32_t>
@@ -147,6 +181,12 @@ public:
     VertexIdx srcId() const { return srcId_; }
     VertexIdx dstId() const { return dstId_; }
 
+    /**
+     * Index of the destination mirror vertex in the dense mirror vertex array
+     * of the tile, or INV_MIRROR_VERTEX_IDX if the destination is local.
+     */
+    MirrorVertexIdx dstMirrorIdx() const { return dstMirrorIdx_; }
+
     EdgeWeightType weight() const { return weight_; }
     void weightIs(const EdgeWeightType& weight) {
         weight_ = weight;
@@ -157,13 +197,15 @@ private:
     VertexIdx srcId_;
     VertexIdx dstId_;
     EdgeWeightType weight_;
+    MirrorVertexIdx dstMirrorIdx_;
 
 private:
     template<typename VDT, typename UDT, typename EWT>
     friend class GraphTile;
 
-    Edge(const VertexIdx& srcId, const VertexIdx& dstId, const EdgeWeightType& weight)
-        : srcId_(srcId), dstId_(dstId), weight_(weight)
+    Edge(const VertexIdx& srcId, const VertexIdx& dstId, const EdgeWeightType& weight,
+            const MirrorVertexIdx& dstMirrorIdx)
+        : srcId_(srcId), dstId_(dstId), weight_(weight), dstMirrorIdx_(dstMirrorIdx)
     {
         // Nothing else to do.
     }
@@ -202,18 +244,23 @@ public:
 
     typedef std::unordered_map< VertexIdx, Ptr<VertexType>, std::hash<VertexIdx::Type> > VertexMap;
     typedef std::vector< EdgeType > EdgeList;
-    typedef std::unordered_map< VertexIdx, Ptr<MirrorVertexType>, std::hash<VertexIdx::Type> > MirrorVertexMap;
+    // Dense index of each mirror vertex.
+    typedef std::unordered_map< VertexIdx, MirrorVertexIdx, std::hash<VertexIdx::Type> > MirrorVertexMap;
+    typedef std::vector< MirrorVertexType > MirrorVertexList;
+    typedef std::pair<MirrorVertexIdx, MirrorVertexIdx> MirrorVertexRange;
 
     typedef typename VertexMap::iterator VertexIter;
     typedef typename VertexMap::const_iterator VertexConstIter;
     typedef typename EdgeList::iterator EdgeIter;
     typedef typename EdgeList::const_iterator EdgeConstIter;
-    typedef typename MirrorVertexMap::iterator MirrorVertexIter;
-    typedef typename MirrorVertexMap::const_iterator MirrorVertexConstIter;
+    typedef typename MirrorVertexList::iterator MirrorVertexIter;
+    typedef typename MirrorVertexList::const_iterator MirrorVertexConstIter;
 
 public:
     explicit GraphTile(const TileIdx& tid)
-        : tid_(tid), vertices_(), edges_(), edgeSorted_(false), finalized_(false),
+        : tid_(tid), vertices_(), edges_(), mirrorVertices_(), mirrorVertexList_(), mirrorVertexOffsets_(),
+          mirrorVertexDirtyList_(),
+          edgeSorted_(false), finalized_(false),
           vidLastVisited_(-1), vLastVisited_(nullptr), mvidLastVisited_(-1), mvLastVisited_(nullptr)
     {
         // Nothing else to do.
@@ -267,11 +314,17 @@ public:
 
     /* Mirror vertices. */
 
-    Ptr<MirrorVertexType> mirrorVertex(const VertexIdx& vid) {
+    /**
+     * Mirror vertex of \c vid, or nullptr if not exists.
+     *
+     * The pointer is invalidated when mirror vertices are added, grouped at
+     * finalizing, or re-allocated.
+     */
+    MirrorVertexType* mirrorVertex(const VertexIdx& vid) {
         if (!finalized_ || vid != mvidLastVisited_) {
             auto it = mirrorVertices_.find(vid);
             if (it != mirrorVertices_.end()) {
-                mvLastVisited_ = it->second;
+                mvLastVisited_ = &mirrorVertexList_[it->second];
             } else {
                 mvLastVisited_ = nullptr;
             }
@@ -280,18 +333,68 @@ public:
         return mvLastVisited_;
     }
 
+    /**
+     * Iterate mirror vertices in the order of the dense mirror vertex array.
+     */
     inline MirrorVertexConstIter mirrorVertexIter() const {
-        return mirrorVertices_.cbegin();
+        return mirrorVertexList_.cbegin();
     }
     inline MirrorVertexConstIter mirrorVertexIterEnd() const {
-        return mirrorVertices_.cend();
+        return mirrorVertexList_.cend();
     }
 
     inline MirrorVertexIter mirrorVertexIter() {
-        return mirrorVertices_.begin();
+        return mirrorVertexList_.begin();
     }
     inline MirrorVertexIter mirrorVertexIterEnd() {
-        return mirrorVertices_.end();
+        return mirrorVertexList_.end();
+    }
+
+    size_t mirrorVertexCount() const { return mirrorVertexList_.size(); }
+
+    /**
+     * Access mirror vertex by its index in the dense mirror vertex array,
+     * e.g., Edge::dstMirrorIdx(). No hash lookup.
+     */
+    inline MirrorVertexType& mirrorVertexAt(const MirrorVertexIdx& idx) {
+        return mirrorVertexList_[idx];
+    }
+    inline const MirrorVertexType& mirrorVertexAt(const MirrorVertexIdx& idx) const {
+        return mirrorVertexList_[idx];
+    }
+
+    /**
+     * Dense indices of the mirror vertices which have accumulated updates since
+     * last reset, in the order of first touch.
+     */
+    inline const MirrorVertexIdxList& mirrorVertexDirtyList() const {
+        return mirrorVertexDirtyList_;
+    }
+
+    /**
+     * Delete all updates in the dirty mirror vertices, and clear the dirty list.
+     */
+    void mirrorVertexDirtyDelAll() {
+        for (const auto idx : mirrorVertexDirtyList_) {
+            mirrorVertexList_[idx].updateDelAll();
+        }
+        mirrorVertexDirtyList_.clear();
+    }
+
+    /**
+     * Range [first, second) of the dense indices of the mirror vertices whose
+     * master tile is \c masterTileId.
+     *
+     * Mirror vertices are grouped by master tile only after finalized.
+     */
+    MirrorVertexRange mirrorVertexRange(const TileIdx& masterTileId) const {
+        if (!finalized_) {
+            throw PermissionException(string(__func__) + ": Graph tile has not been finalized.");
+        }
+        if (masterTileId + 1 >= mirrorVertexOffsets_.size()) {
+            return MirrorVertexRange(mirrorVertexCount(), mirrorVertexCount());
+        }
+        return MirrorVertexRange(mirrorVertexOffsets_[masterTileId], mirrorVertexOffsets_[masterTileId + 1]);
     }
 
     /* Edges. */
@@ -306,19 +409,28 @@ public:
         if (dstTileId == tid_ && vertices_.count(dstId) == 0) {
             throw RangeException(std::to_string(dstId));
         }
-        if (dstTileId != tid_ && mirrorVertices_.count(dstId) == 0) {
-            // Create mirror vertex if destination vertex is in different tile.
-            auto mirrorVertex = Ptr<MirrorVertexType>(new MirrorVertexType(dstId, dstTileId));
-            mirrorVertices_.insert( typename MirrorVertexMap::value_type(dstId, mirrorVertex) );
+        MirrorVertexIdx dstMirrorIdx = INV_MIRROR_VERTEX_IDX;
+        if (dstTileId != tid_) {
+            auto mvIter = mirrorVertices_.find(dstId);
+            if (mvIter == mirrorVertices_.end()) {
+                // Create mirror vertex if destination vertex is in different tile.
+                if (mirrorVertexList_.size() >= INV_MIRROR_VERTEX_IDX) {
+                    throw RangeException(std::to_string(dstId));
+                }
+                const MirrorVertexIdx idx = mirrorVertexList_.size();
+                mirrorVertexList_.push_back(MirrorVertexType(dstId, dstTileId, idx, &mirrorVertexDirtyList_));
+                mvIter = mirrorVertices_.insert( typename MirrorVertexMap::value_type(dstId, idx) ).first;
+            }
+            dstMirrorIdx = mvIter->second;
         }
         // Repeating edges with the same srcId and dstId are accepted.
         // Use move constructor.
-        edges_.push_back(EdgeType(srcId, dstId, weight));
+        edges_.push_back(EdgeType(srcId, dstId, weight, dstMirrorIdx));
         edgeSorted_ &= EdgeType::lessFunc(edges_[edges_.size()-2], edges_[edges_.size()-1]);
         // Increment degree.
         vertex(srcId)->outDegInc();
         if (dstTileId != tid_) {
-            mirrorVertex(dstId)->accDegInc();
+            mirrorVertexList_[dstMirrorIdx].accDegInc();
         } else {
             vertex(dstId)->inDegInc();
         }
@@ -348,6 +460,56 @@ public:
 
     size_t edgeCount() const { return edges_.size(); }
 
+    /**
+     * Re-allocate vertices, edges and mirror vertices on the calling thread.
+     *
+     * With the first-touch NUMA policy, the memory of the tile is then placed
+     * on the node of the calling thread, e.g., the worker thread that will
+     * process it, rather than the loader thread. Vertex data must be copyable.
+     *
+     * Only allowed after finalized. Invalidates pointers to vertices and
+     * mirror vertices obtained before.
+     */
+    void reallocLocal() {
+        if (!finalized_) {
+            throw PermissionException(string(__func__) + ": Graph tile has not been finalized.");
+        }
+
+        VertexMap vertices(vertices_.bucket_count(), vertices_.hash_function());
+        for (const auto& p : vertices_) {
+            vertices.insert( typename VertexMap::value_type(p.first, Ptr<VertexType>(new VertexType(*p.second))) );
+        }
+        vertices_.swap(vertices);
+
+        EdgeList edges;
+        edges.reserve(edges_.size());
+        for (const auto& e : edges_) {
+            edges.push_back(EdgeType(e.srcId_, e.dstId_, e.weight_, e.dstMirrorIdx_));
+        }
+        edges_.swap(edges);
+
+        MirrorVertexMap(mirrorVertices_).swap(mirrorVertices_);
+        MirrorVertexList mirrorVertexList;
+        mirrorVertexList.reserve(mirrorVertexList_.size());
+        for (auto& mv : mirrorVertexList_) {
+            mirrorVertexList.push_back(std::move(mv));
+        }
+        mirrorVertexList_.swap(mirrorVertexList);
+        std::vector<MirrorVertexIdx>(mirrorVertexOffsets_).swap(mirrorVertexOffsets_);
+
+        // The dirty list holds at most all mirror vertices, never grow later.
+        MirrorVertexIdxList dirtyList;
+        dirtyList.reserve(mirrorVertexList_.size());
+        dirtyList.assign(mirrorVertexDirtyList_.begin(), mirrorVertexDirtyList_.end());
+        mirrorVertexDirtyList_.swap(dirtyList);
+
+        // Invalidate cache.
+        vidLastVisited_ = -1;
+        vLastVisited_ = nullptr;
+        mvidLastVisited_ = -1;
+        mvLastVisited_ = nullptr;
+    }
+
     bool finalized() const { return finalized_; }
     void finalizedIs(const bool finalized) {
         if (!finalized_ && finalized) {
@@ -357,16 +519,19 @@ public:
             edgeSortedIs(true);
 
             // Check mirror vertex acc degree has been propagated to other tiles and cleared.
-            for (auto mvIter = mirrorVertexIter(); mvIter != mirrorVertexIterEnd(); ++mvIter) {
-                const auto mv = mvIter->second;
-                if (mv->accDeg() != 0) {
+            for (auto& mv : mirrorVertexList_) {
+                if (mv.accDeg() != 0) {
                     throw PermissionException("Cannot finalize graph tile " + std::to_string(tid_)
-                            + " due to uncleared mirror vertex " + std::to_string(mv->vid())
+                            + " due to uncleared mirror vertex " + std::to_string(mv.vid())
                             + " acc degree.");
                 }
                 // Reset application update.
-                mv->updateDelAll();
+                mv.updateDelAll();
             }
+            mirrorVertexDirtyList_.clear();
+
+            // Group mirror vertices by master tile in the dense array.
+            mirrorVertexListGroup();
 
         }
         finalized_ = finalized;
@@ -380,6 +545,19 @@ private:
 
     MirrorVertexMap mirrorVertices_;
 
+    /**
+     * Dense array of the mirror vertices, stored by value. After finalized,
+     * grouped by master tile index, and then sorted by vertex index.
+     *
+     * Mirror vertices of master tile \c t are in range
+     * [mirrorVertexOffsets_[t], mirrorVertexOffsets_[t+1]).
+     */
+    MirrorVertexList mirrorVertexList_;
+    std::vector<MirrorVertexIdx> mirrorVertexOffsets_;
+
+    // Mirror vertices with accumulated updates.
+    MirrorVertexIdxList mirrorVertexDirtyList_;
+
     bool edgeSorted_;
 
     /**
@@ -394,9 +572,44 @@ private:
     VertexIdx vidLastVisited_;
     Ptr<VertexType> vLastVisited_;
     VertexIdx mvidLastVisited_;
-    Ptr<MirrorVertexType> mvLastVisited_;
+    MirrorVertexType* mvLastVisited_;
 
 private:
+    void mirrorVertexListGroup() {
+        auto lessFunc = [](const MirrorVertexType& mv1, const MirrorVertexType& mv2) {
+            if (mv1.masterTileId() == mv2.masterTileId()) return mv1.vid() < mv2.vid();
+            return mv1.masterTileId() < mv2.masterTileId();
+        };
+        std::sort(mirrorVertexList_.begin(), mirrorVertexList_.end(), lessFunc);
+        // Cached mirror vertex has been moved.
+        mvidLastVisited_ = -1;
+        mvLastVisited_ = nullptr;
+
+        // Remap mirror vertex indices in edges and the index map.
+        std::vector<MirrorVertexIdx> newIdx(mirrorVertexList_.size());
+        for (size_t idx = 0; idx < mirrorVertexList_.size(); idx++) {
+            auto& mv = mirrorVertexList_[idx];
+            newIdx[mv.idx_] = idx;
+            mv.idx_ = idx;
+            mirrorVertices_[mv.vid()] = idx;
+        }
+        for (auto& e : edges_) {
+            if (e.dstMirrorIdx_ != INV_MIRROR_VERTEX_IDX) {
+                e.dstMirrorIdx_ = newIdx[e.dstMirrorIdx_];
+            }
+        }
+
+        // Offsets of each master tile.
+        mirrorVertexOffsets_.assign(1, 0);
+        for (size_t idx = 0; idx < mirrorVertexList_.size(); idx++) {
+            auto masterTileId = mirrorVertexList_[idx].masterTileId();
+            while (mirrorVertexOffsets_.size() <= masterTileId) {
+                mirrorVertexOffsets_.push_back(idx);
+            }
+        }
+        mirrorVertexOffsets_.push_back(mirrorVertexList_.size());
+    }
+
     void checkNotFinalized(const string& funcName) {
         if (finalized_) {
             throw PermissionException(funcName + ": Graph tile has already been finalized.");
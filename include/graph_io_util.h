@@ -21,6 +21,57 @@ inline static std::istream& nextEffectiveLine(std::istream& input, string& line)
     return input;
 }
 
+/**
+ * Read edge list file, and call \c func with <tt>(srcId, dstId, weight)</tt>
+ * of each edge.
+ *
+ * @param edgeListFileName      graph topology file in edge list format.
+ * @param defaultWeight         The default edge weight value, used when no weight
+ *                              is given in the edge list file.
+ */
+template<typename WeightType, typename Func>
+void edgeListForEach(const string& edgeListFileName, const WeightType& defaultWeight, Func&& func) {
+    if (edgeListFileName.empty()) {
+        throw FileException(edgeListFileName);
+    }
+    std::ifstream infile(edgeListFileName, std::ifstream::in);
+    if (!infile.is_open()) {
+        throw FileException(edgeListFileName);
+    }
+    string line;
+
+    while (nextEffectiveLine(infile, line)) {
+        // Line format: <srcId> <dstId> [weight]
+
+        // A faster way to convert string to numbers than using operator>>.
+        const char* pbegin = line.c_str();
+        char* pend = nullptr;
+        uint64_t srcId = strtoull(pbegin, &pend, 10);
+        if (pend == pbegin || errno == ERANGE) {
+            // No conversion or out of range.
+            throw FileException(edgeListFileName);
+        }
+        pbegin = pend;
+        uint64_t dstId = strtoull(pbegin, &pend, 10);
+        if (pend == pbegin || errno == ERANGE) {
+            // No conversion or out of range.
+            throw FileException(edgeListFileName);
+        }
+        pbegin = pend;
+
+        WeightType weight = defaultWeight;
+        line = line.substr(pbegin - line.c_str());
+        if (line.find_first_not_of(" \t\n\v\f\r") != std::string::npos) {
+            std::istringstream iss(line);
+            if (!(iss >> weight)) {
+                throw FileException(edgeListFileName);
+            }
+        }
+
+        func(srcId, dstId, weight);
+    }
+}
+
 /**
  * Read graph topology from edge list file (and partition file).
  *
@@ -33,16 +84,19 @@ inline static std::istream& nextEffectiveLine(std::istream& input, string& line)
  * @param tileMergeFactor       The factor for tile merge. The actual tile index of
  *                              a vertex will be the index in the partition file
  *                              divided by this factor.
+ * @param pred                  Only the edges in the edge list file for which
+ *                              <tt>pred(srcId, dstId, weight)</tt> is true are
+ *                              loaded, e.g., to hold out a subset of edges.
  * @param vertexArgs            Used by vertex constructor.
  *
  * @return                      graph tiles.
  */
-template<typename GraphTileType, typename... Args>
-std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
+template<typename GraphTileType, typename EdgePred, typename... Args>
+std::vector< Ptr<GraphTileType> > graphTilesFromEdgeListIf(const size_t tileCount,
         const string& edgeListFileName, const string& partitionFileName,
         const typename GraphTileType::EdgeType::WeightType& defaultWeight,
         const bool undirected, const size_t tileMergeFactor, const bool finalize,
-        Args&&... vertexArgs) {
+        const EdgePred& pred, Args&&... vertexArgs) {
 
     try{
         std::vector< Ptr<GraphTileType> > tiles(tileCount);
@@ -94,55 +148,20 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
             }
         };
 
-        // Read edge list file, build the graph tiles.
-        if (edgeListFileName.empty()) {
-            throw FileException(edgeListFileName);
-        }
-        std::ifstream infile(edgeListFileName, std::ifstream::in);
-        if (!infile.is_open()) {
-            throw FileException(edgeListFileName);
-        }
-        string line;
-
         // Store edge info while reading file, then use multiple load threads to build tiles.
         struct EdgeInfo {
             VertexIdx srcId;
             VertexIdx dstId;
             typename GraphTileType::EdgeType::WeightType weight;
-            TileIdx srcTid;
             TileIdx dstTid;
         };
-        // Graph tiles for thread i will be loaded by load thread i % loadThreadCount.
-        constexpr uint32_t loadThreadCount = 8;
-        std::array<std::vector<EdgeInfo>, loadThreadCount> edgeInfoArray;
-
-        while (nextEffectiveLine(infile, line)) {
-            // Line format: <srcId> <dstId> [weight]
-
-            // A faster way to convert string to numbers than using operator>>.
-            const char* pbegin = line.c_str();
-            char* pend = nullptr;
-            uint64_t srcId = strtoull(pbegin, &pend, 10);
-            if (pend == pbegin || errno == ERANGE) {
-                // No conversion or out of range.
-                throw FileException(edgeListFileName);
-            }
-            pbegin = pend;
-            uint64_t dstId = strtoull(pbegin, &pend, 10);
-            if (pend == pbegin || errno == ERANGE) {
-                // No conversion or out of range.
-                throw FileException(edgeListFileName);
-            }
-            pbegin = pend;
+        // Edges are grouped by source tile, and each tile is loaded by one task.
+        std::vector<std::vector<EdgeInfo>> edgeInfoArray(tileCount);
 
-            typename GraphTileType::EdgeType::WeightType weight = defaultWeight;
-            line = line.substr(pbegin - line.c_str());
-            if (line.find_first_not_of(" \t\n\v\f\r") != std::string::npos) {
-                std::istringstream iss(line);
-                if (!(iss >> weight)) {
-                    throw FileException(edgeListFileName);
-                }
-            }
+        // Read edge list file, build the graph tiles.
+        edgeListForEach(edgeListFileName, defaultWeight, [&](const uint64_t srcId, const uint64_t dstId,
+                    const typename GraphTileType::EdgeType::WeightType& weight) {
+            if (!pred(srcId, dstId, weight)) return;
 
             // Get corresponding tile and add vertex if hasn't been done.
             const auto srcTid = vertexTileIdx(srcId);
@@ -155,21 +174,24 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
             }
 
             // Store edge info.
-            edgeInfoArray[srcTid % loadThreadCount].push_back(EdgeInfo{srcId, dstId, weight, srcTid, dstTid});
+            edgeInfoArray[srcTid].push_back(EdgeInfo{srcId, dstId, weight, dstTid});
             if (undirected) {
-                edgeInfoArray[dstTid % loadThreadCount].push_back(EdgeInfo{dstId, srcId, weight, dstTid, srcTid});
+                edgeInfoArray[dstTid].push_back(EdgeInfo{dstId, srcId, weight, srcTid});
             }
-        }
+        });
 
-        ThreadPool loadPool(loadThreadCount);
-        auto loadFunc = [&edgeInfoArray, &tiles](uint32_t idx) {
-            for (const auto& e : edgeInfoArray[idx]) {
+        constexpr uint32_t loadThreadCount = 8;
+        ThreadPool loadPool(std::min<size_t>(loadThreadCount, tileCount));
+        auto loadFunc = [&edgeInfoArray, &tiles](size_t tid) {
+            for (const auto& e : edgeInfoArray[tid]) {
                 // Add edge.
-                tiles[e.srcTid]->edgeNew(e.srcId, e.dstId, e.dstTid, e.weight);
+                tiles[tid]->edgeNew(e.srcId, e.dstId, e.dstTid, e.weight);
             }
+            // Release memory early.
+            std::vector<EdgeInfo>().swap(edgeInfoArray[tid]);
         };
-        for (uint32_t idx = 0; idx < loadThreadCount; idx++) {
-            loadPool.add_task(std::bind(loadFunc, idx));
+        for (size_t tid = 0; tid < tileCount; tid++) {
+            loadPool.add_task([&loadFunc, tid]{ loadFunc(tid); });
         }
         loadPool.wait_all();
 
@@ -178,11 +200,10 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
             for (auto& t : tiles) {
                 // Propagate mirror vertex degree to master tile.
                 for (auto mvIter = t->mirrorVertexIter(); mvIter != t->mirrorVertexIterEnd(); ++mvIter) {
-                    auto& mv = mvIter->second;
-                    auto vid = mv->vid();
-                    auto masterTileId = mv->masterTileId();
-                    tiles[masterTileId]->vertex(vid)->inDegInc(mv->accDeg());
-                    mv->accDegDel();
+                    auto vid = mvIter->vid();
+                    auto masterTileId = mvIter->masterTileId();
+                    tiles[masterTileId]->vertex(vid)->inDegInc(mvIter->accDeg());
+                    mvIter->accDegDel();
                 }
                 t->finalizedIs(true);
             }
@@ -200,6 +221,24 @@ std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
     }
 }
 
+/**
+ * Read graph topology from edge list file (and partition file), loading all
+ * edges. See graphTilesFromEdgeListIf().
+ */
+template<typename GraphTileType, typename... Args>
+std::vector< Ptr<GraphTileType> > graphTilesFromEdgeList(const size_t tileCount,
+        const string& edgeListFileName, const string& partitionFileName,
+        const typename GraphTileType::EdgeType::WeightType& defaultWeight,
+        const bool undirected, const size_t tileMergeFactor, const bool finalize,
+        Args&&... vertexArgs) {
+    return graphTilesFromEdgeListIf<GraphTileType>(tileCount, edgeListFileName, partitionFileName,
+            defaultWeight, undirected, tileMergeFactor, finalize,
+            [](const uint64_t, const uint64_t, const typename GraphTileType::EdgeType::WeightType&) {
+                return true;
+            },
+            std::forward<Args>(vertexArgs)...);
+}
+
 } // namespace GraphIOUtil
 
 } // namespace GraphGASLite
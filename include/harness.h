@@ -28,6 +28,9 @@ const ArgInfo optInfoList[] = {
     {"-m", "[maxiter]", "Maximum iteration number (default " + std::to_string(maxItersDefault) + ")."},
     {"-p", "[numParts]", "Number of partitions per thread (default " + std::to_string(numPartsDefault) + ")."},
     {"-u", "", "Undirected graph (default directed)."},
+    {"-d", "", "Dynamically schedule all graph tiles to threads (default merge into one tile per thread)."},
+    {"-a", "[affinity]", "Pin threads to a core or a socket, i.e., core, socket, or none (default none)."},
+    {"-s", "", "Asynchronous mode, apply updates as they arrive until quiescence, not with -d (default synchronous)."},
     {"-h", "", "Print this help message."},
 };
 
@@ -90,8 +93,8 @@ void algoKernelArgsPrintHelp(const char* appName, const AppArgs& appArgs) {
 template <typename AppArgs>
 int algoKernelArgs(int argc, char** argv,
         size_t& threadCount, size_t& graphTileCount,
-        uint64_t& maxIters, uint32_t& numParts, bool& undirected,
-        string& edgelistFile, string& partitionFile, string& outputFile,
+        uint64_t& maxIters, uint32_t& numParts, bool& undirected, bool& dynamicSched,
+        string& affinity, bool& async, string& edgelistFile, string& partitionFile, string& outputFile,
         AppArgs& appArgs) {
 
     threadCount = 0;
@@ -99,6 +102,9 @@ int algoKernelArgs(int argc, char** argv,
     maxIters = maxItersDefault;
     numParts = numPartsDefault;
     undirected = false;
+    dynamicSched = false;
+    affinity = "none";
+    async = false;
 
     edgelistFile = "";
     partitionFile = "";
@@ -110,7 +116,7 @@ int algoKernelArgs(int argc, char** argv,
 
     int ch;
     opterr = 0; // Reset potential previous errors.
-    while ((ch = getopt(argc, argv, "t:g:m:p:uh")) != -1) {
+    while ((ch = getopt(argc, argv, "t:g:m:p:uda:sh")) != -1) {
         switch (ch) {
             case 't':
                 std::stringstream(optarg) >> threadCount;
@@ -127,6 +133,15 @@ int algoKernelArgs(int argc, char** argv,
             case 'u':
                 undirected = true;
                 break;
+            case 'd':
+                dynamicSched = true;
+                break;
+            case 'a':
+                affinity = optarg;
+                break;
+            case 's':
+                async = true;
+                break;
             case 'h':
             default:
                 return -1;
@@ -137,7 +152,15 @@ int algoKernelArgs(int argc, char** argv,
         std::cerr << "Must specify number of threads and number of graph tiles." << std::endl;
         return -1;
     }
-    if (graphTileCount % threadCount != 0) {
+    if (affinity != "none" && affinity != "core" && affinity != "socket") {
+        std::cerr << "Invalid thread affinity." << std::endl;
+        return -1;
+    }
+    if (async && dynamicSched) {
+        std::cerr << "Asynchronous mode requires static scheduling." << std::endl;
+        return -1;
+    }
+    if (!dynamicSched && graphTileCount % threadCount != 0) {
         std::cerr << "Number of threads must be a divisor of number of graph tiles." << std::endl;
         return -1;
     }
@@ -215,6 +238,12 @@ public:
 
     virtual bool isValid() const { return true; }
 
+    /**
+     * Called with each edge in the edge list file when loading the graph.
+     * Return false to leave the edge out of the graph.
+     */
+    virtual bool edgeLoaded(const uint64_t, const uint64_t, const double) { return true; }
+
 protected:
     std::tuple<ArgTypes...> argTuple_;
 
@@ -0,0 +1,152 @@
+#ifndef TILE_SCHEDULER_H_
+#define TILE_SCHEDULER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "common.h"
+
+namespace GraphGASLite {
+
+/**
+ * Distribute graph tiles to worker threads in each phase of an iteration.
+ *
+ * If there are as many workers as tiles, each worker always works on the tile
+ * with the same index. Otherwise workers dynamically claim tiles, so
+ * fine-grained tiles can be balanced across fewer workers. Each worker first
+ * claims its home tiles, i.e., tile \c t for worker <tt>t % workerCount</tt>,
+ * which the engine places on the node of that worker, and then takes the
+ * remaining tiles of others from a shared counter.
+ *
+ * All workers must call tileForEach() in each phase, and phases must be
+ * separated by barriers among all workers.
+ */
+class TileScheduler {
+public:
+    TileScheduler(const uint32_t tileCount, const uint32_t workerCount)
+        : tileCount_(tileCount), workerCount_(workerCount),
+          tileOrder_(tileCount), phases_(new WorkerPhase[workerCount ? workerCount : 1]),
+          claims_(new TileClaim[tileCount ? tileCount : 1])
+    {
+        if (workerCount_ == 0 || workerCount_ > tileCount_) {
+            throw InvalidArgumentException("workerCount");
+        }
+        for (uint32_t idx = 0; idx < tileCount_; idx++) {
+            tileOrder_[idx] = idx;
+        }
+        for (uint32_t idx = 0; idx < tileCount_; idx++) {
+            claims_[idx].phase.store(0);
+        }
+        counters_[0].next.store(0);
+        counters_[1].next.store(0);
+    }
+
+    uint32_t tileCount() const { return tileCount_; }
+
+    uint32_t workerCount() const { return workerCount_; }
+
+    /**
+     * If tiles are dynamically claimed by workers.
+     */
+    bool dynamic() const { return workerCount_ < tileCount_; }
+
+    /**
+     * The order in which the tiles left after the home tiles are claimed in
+     * dynamic scheduling. Claiming larger tiles first reduces the time
+     * waiting for a straggler tile.
+     *
+     * Must be a permutation of all tile indices.
+     */
+    const std::vector<uint32_t>& tileOrder() const { return tileOrder_; }
+    void tileOrderIs(const std::vector<uint32_t>& tileOrder) {
+        if (tileOrder.size() != tileCount_) {
+            throw InvalidArgumentException("tileOrder");
+        }
+        std::vector<bool> seen(tileCount_, false);
+        for (const auto idx : tileOrder) {
+            if (idx >= tileCount_ || seen[idx]) {
+                throw InvalidArgumentException("tileOrder");
+            }
+            seen[idx] = true;
+        }
+        tileOrder_ = tileOrder;
+    }
+
+    /**
+     * Call \c func with the index of each tile that is assigned to worker
+     * \c workerId in the current phase. Each tile is assigned to exactly one
+     * worker in each phase.
+     */
+    template<typename Func>
+    void tileForEach(const uint32_t workerId, Func&& func) {
+        if (!dynamic()) {
+            func(workerId);
+            return;
+        }
+
+        const auto phase = phases_[workerId].phase++;
+        // Reset the counter for the next phase. All workers have finished
+        // claiming from it in the previous phase before the barrier.
+        counters_[(phase + 1) % 2].next.store(0, std::memory_order_relaxed);
+
+        // Home tiles first.
+        for (uint32_t idx = workerId; idx < tileCount_; idx += workerCount_) {
+            if (claim(idx, phase)) func(idx);
+        }
+
+        // Then the tiles not yet claimed by their home workers.
+        auto& next = counters_[phase % 2].next;
+        while (true) {
+            const auto pos = next.fetch_add(1, std::memory_order_relaxed);
+            if (pos >= tileCount_) break;
+            const auto idx = tileOrder_[pos];
+            if (claim(idx, phase)) func(idx);
+        }
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct WorkerPhase {
+        uint64_t phase = 0;
+        char pad_[CACHE_LINE - sizeof(uint64_t)];
+    };
+
+    struct Counter {
+        std::atomic<uint32_t> next;
+        char pad_[CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+    };
+
+    struct TileClaim {
+        // Number of phases in which the tile has been claimed.
+        std::atomic<uint64_t> phase;
+        char pad_[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+    };
+
+    const uint32_t tileCount_;
+    const uint32_t workerCount_;
+
+    std::vector<uint32_t> tileOrder_;
+
+    // Number of phases each worker has started.
+    std::unique_ptr<WorkerPhase[]> phases_;
+
+    // Per-tile claims, so each tile is claimed once per phase either by its
+    // home worker or from the shared counter.
+    std::unique_ptr<TileClaim[]> claims_;
+
+    // Alternate the claim counters b/w consecutive phases.
+    Counter counters_[2];
+
+private:
+    /**
+     * Claim tile \c idx in phase \c phase. Only one worker succeeds.
+     */
+    bool claim(const uint32_t idx, const uint64_t phase) {
+        return claims_[idx].phase.exchange(phase + 1, std::memory_order_relaxed) <= phase;
+    }
+};
+
+} // namespace GraphGASLite
+
+#endif // TILE_SCHEDULER_H_
@@ -64,6 +64,20 @@ class Stream {
             stream.clear();
         }
 
+        /**
+         * Re-allocate the storage with the same capacity, and touch it from
+         * the calling thread. With the first-touch NUMA policy, the memory is
+         * placed on the node of the calling thread.
+         */
+        void realloc() {
+            std::vector<Data> s;
+            s.reserve(stream.capacity());
+            s.assign(stream.begin(), stream.end());
+            s.resize(stream.capacity());
+            s.resize(stream.size());
+            stream.swap(s);
+        }
+
         void swap(Stream<Data>& s) {
             stream.swap(s.stream);
         }
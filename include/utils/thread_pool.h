@@ -1,65 +1,204 @@
 #ifndef UTILS_THREAD_POOL_H_
 #define UTILS_THREAD_POOL_H_
 /**
- * Thread pool.
+ * Work-stealing thread pool.
+ *
+ * Each worker owns a Chase-Lev work-stealing deque. Tasks added from a worker
+ * go to its own deque without locking; tasks added from outside go to the
+ * inbox of the target worker. Idle workers steal from the others before
+ * parking.
+ *
+ * See D. Chase and Y. Lev, Dynamic circular work-stealing deque, SPAA'05, and
+ * N. M. Le et al., Correct and efficient work-stealing for weak memory
+ * models, PPoPP'13.
  */
-#include <queue>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 #include "log.h"
 #include "threads.h"
 
-typedef std::function<void()> TaskType;
+/**
+ * Task with inline storage.
+ *
+ * Small trivially copyable callables (e.g., lambdas capturing pointers,
+ * references, or indices) are stored inline without heap allocation. Others
+ * fall back to a heap-allocated copy, which is freed after execution.
+ *
+ * The task itself is trivially copyable, so it can be stored in the deque
+ * slots by value.
+ */
+class Task {
+    public:
+        static constexpr size_t INLINE_SIZE = 48;
+
+        Task() : invoke_(nullptr) {}
+
+        template<typename F, typename = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+        Task(F&& f) : invoke_(nullptr) {
+            typedef typename std::decay<F>::type FType;
+            construct<FType>(std::forward<F>(f),
+                    std::integral_constant<bool, isInline<FType>()>());
+        }
+
+        explicit operator bool() const { return invoke_ != nullptr; }
+
+        /**
+         * Run the task. Must be called exactly once for a valid task, in order
+         * to release any heap storage.
+         */
+        void operator()() {
+            invoke_(buf_);
+        }
+
+    private:
+        void (*invoke_)(void*);
+        alignas(alignof(std::max_align_t)) unsigned char buf_[INLINE_SIZE];
+
+    private:
+        template<typename F>
+        static constexpr bool isInline() {
+            return std::is_trivially_copyable<F>::value && sizeof(F) <= INLINE_SIZE
+                && alignof(std::max_align_t) % alignof(F) == 0;
+        }
+
+        template<typename F, typename FArg>
+        void construct(FArg&& f, std::true_type) {
+            new (buf_) F(std::forward<FArg>(f));
+            invoke_ = [](void* buf) { (*reinterpret_cast<F*>(buf))(); };
+        }
+
+        template<typename F, typename FArg>
+        void construct(FArg&& f, std::false_type) {
+            auto* pf = new F(std::forward<FArg>(f));
+            std::memcpy(buf_, &pf, sizeof(pf));
+            invoke_ = [](void* buf) {
+                F* pf = *reinterpret_cast<F**>(buf);
+                (*pf)();
+                delete pf;
+            };
+        }
+};
+
+typedef Task TaskType;
 
-class TaskQueue {
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * Only the owner thread can push and pop at the bottom. Any thread can steal
+ * from the top.
+ */
+class TaskDeque {
     public:
-        TaskQueue() : stop(false) {}
-        ~TaskQueue() {}
+        TaskDeque() : top_(0), bottom_(0) {
+            rings_.emplace_back(new Ring(INIT_CAPACITY));
+            ring_.store(rings_.back().get(), std::memory_order_relaxed);
+        }
 
-        // Move
-        TaskQueue(TaskQueue&&) = default;
-        TaskQueue& operator=(TaskQueue&&) = default;
-        // No copy
-        TaskQueue(const TaskQueue&) = delete;
-        TaskQueue& operator=(const TaskQueue&) = delete;
+        TaskDeque(const TaskDeque&) = delete;
+        TaskDeque& operator=(const TaskDeque&) = delete;
 
-        void enqueue(const TaskType& task) {
-            mutex_begin(uqlk, lock_);
-            if (stop) {
-                throw std::runtime_error("TaskQueue: enqueue on stopped task queue!");
+        /**
+         * Owner only.
+         */
+        void push(const Task& task) {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            Ring* r = ring_.load(std::memory_order_relaxed);
+            if (b - t > static_cast<int64_t>(r->mask)) {
+                r = grow(r, t, b);
             }
-            if (!task) {
-                throw std::runtime_error("TaskQueue: enqueue empty task!");
+            r->put(b, task);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Owner only.
+         */
+        bool pop(Task& task) {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Ring* r = ring_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b) {
+                // Empty.
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
             }
-            queue_.push(task);
-            mutex_end();
-            enqueue_.notify_one();
+            task = r->get(b);
+            if (t == b) {
+                // Last one, race with thieves.
+                bool won = top_.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
         }
 
-        // blocked
-        TaskType dequeue() {
-            mutex_begin(uqlk, lock_);
-            enqueue_.wait(uqlk, [this]{ return !queue_.empty() || stop; });
-            if (stop && queue_.empty()) {
-                // empty task
-                return std::function<void()>();
+        /**
+         * Any thread.
+         */
+        bool steal(Task& task) {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b) return false;
+            Ring* r = ring_.load(std::memory_order_acquire);
+            // The slot may be overwritten by the owner only after another
+            // thief has advanced top, in which case the CAS below fails and
+            // the copy is discarded.
+            Task stolen = r->get(t);
+            if (!top_.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return false;
             }
-            TaskType task = queue_.front();
-            queue_.pop();
-            return task;
-            mutex_end();
+            task = stolen;
+            return true;
         }
 
-        void close() {
-            mutex_begin(uqlk, lock_);
-            stop = true;
-            mutex_end();
-            enqueue_.notify_all();
+        bool empty() const {
+            return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
         }
 
     private:
-        std::queue<TaskType> queue_;
-        lock_t lock_;
-        cond_t enqueue_;
-        bool stop;
+        static constexpr size_t INIT_CAPACITY = 64;
+
+        struct Ring {
+            const size_t mask;
+            std::unique_ptr<Task[]> slots;
+
+            explicit Ring(size_t capacity) : mask(capacity - 1), slots(new Task[capacity]) {}
+
+            void put(int64_t idx, const Task& task) { slots[idx & mask] = task; }
+            Task get(int64_t idx) const { return slots[idx & mask]; }
+        };
+
+        std::atomic<int64_t> top_;
+        std::atomic<int64_t> bottom_;
+        std::atomic<Ring*> ring_;
+
+        // All rings ever allocated. Old rings may still be read by thieves, so
+        // they are only freed with the deque.
+        std::vector<std::unique_ptr<Ring>> rings_;
+
+    private:
+        Ring* grow(Ring* r, int64_t t, int64_t b) {
+            rings_.emplace_back(new Ring((r->mask + 1) * 2));
+            Ring* nr = rings_.back().get();
+            for (int64_t idx = t; idx < b; idx++) nr->put(idx, r->get(idx));
+            ring_.store(nr, std::memory_order_release);
+            return nr;
+        }
 };
 
 class ThreadPool {
@@ -68,80 +207,231 @@ class ThreadPool {
         static const tid_t INV_TID = ((uint32_t)-1);
 
         ThreadPool(uint32_t num_workers) :
-            num_workers_(num_workers), queues_(num_workers_),
-            num_tasks_(0), cur_worker_(0) {
+            num_workers_(num_workers), num_tasks_(0), cur_worker_(0),
+            stop_(false), signal_(0), sleepers_(0) {
 
+            for (tid_t tid = 0; tid < num_workers_; tid++) {
+                queues_.emplace_back(new WorkerQueue());
+            }
             for (tid_t tid = 0; tid < num_workers_; tid++) {
                 workers_.emplace_back(&ThreadPool::worker_func, this, tid);
             }
         }
 
         ~ThreadPool() {
-            for (auto& q : queues_) {
-                q.close();
-            }
+            wait_all();
+            stop_.store(true);
+            wake_all();
             for (auto& w : workers_) {
                 w.join();
             }
         }
 
-        // Move
-        ThreadPool(ThreadPool&&) = default;
-        ThreadPool& operator=(ThreadPool&&) = default;
-        // No copy
+        // No copy or move
         ThreadPool(const ThreadPool&) = delete;
         ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        uint32_t num_workers() const { return num_workers_; }
 
+        /**
+         * Add a task.
+         *
+         * From a worker of this pool, the task is pushed to its own deque.
+         * Otherwise it goes to the inbox of worker \c tid, or round-robin if
+         * not specified. Either way, idle workers may steal it.
+         */
         void add_task(const TaskType& task, tid_t tid = INV_TID) {
-            if (tid == INV_TID) {
-                tid = next_worker();
+            if (!task) {
+                throw std::runtime_error("ThreadPool: add empty task!");
             }
 
-            mutex_begin(uqlk, st_lk_);
-            num_tasks_++;
-            mutex_end();
+            num_tasks_.fetch_add(1);
 
-            queues_[tid].enqueue(task);
+            const auto& self = this_worker();
+            if (self.pool == this && (tid == INV_TID || tid == self.tid)) {
+                queues_[self.tid]->deque.push(task);
+            } else {
+                if (tid == INV_TID) {
+                    tid = next_worker();
+                }
+                auto& q = *queues_[tid];
+                mutex_begin(uqlk, q.inbox_lk);
+                q.inbox.push_back(task);
+                q.inbox_size.store(q.inbox.size());
+                mutex_end();
+            }
+
+            signal_.fetch_add(1);
+            if (sleepers_.load() > 0) {
+                wake_all();
+            }
         }
 
         void wait_all() {
-            mutex_begin(uqlk, st_lk_);
-            task_done_.wait(uqlk, [this]{ return num_tasks_ == 0; });
+            for (uint32_t i = 0; i < SPIN_COUNT; i++) {
+                if (num_tasks_.load() == 0) return;
+                std::this_thread::yield();
+            }
+            mutex_begin(uqlk, done_lk_);
+            task_done_.wait(uqlk, [this]{ return num_tasks_.load() == 0; });
             mutex_end();
         }
 
     private:
+        static constexpr uint32_t SPIN_COUNT = 64;
+
+        struct WorkerQueue {
+            TaskDeque deque;
+
+            // Tasks added from outside the pool.
+            lock_t inbox_lk;
+            std::vector<TaskType> inbox;
+            std::atomic<size_t> inbox_size;
+
+            WorkerQueue() : inbox_size(0) {}
+        };
+
+        struct WorkerInfo {
+            const ThreadPool* pool;
+            tid_t tid;
+        };
+
         uint32_t num_workers_;
         std::vector<thread_t> workers_;
 
-        std::vector<TaskQueue> queues_;
+        std::vector<std::unique_ptr<WorkerQueue>> queues_;
 
         // Track number of pending tasks
-        lock_t st_lk_;
+        std::atomic<uint32_t> num_tasks_;
+        lock_t done_lk_;
         cond_t task_done_;
-        uint32_t num_tasks_;
 
         // For task assignment
-        tid_t cur_worker_;
+        std::atomic<tid_t> cur_worker_;
+
+        // For parking idle workers
+        std::atomic<bool> stop_;
+        std::atomic<uint64_t> signal_;
+        std::atomic<uint32_t> sleepers_;
+        lock_t park_lk_;
+        cond_t park_cv_;
 
     private:
+        static WorkerInfo& this_worker() {
+            static thread_local WorkerInfo info{nullptr, INV_TID};
+            return info;
+        }
 
         tid_t next_worker() {
-            return cur_worker_ = (cur_worker_ + 1) % num_workers_;
+            return cur_worker_.fetch_add(1) % num_workers_;
+        }
+
+        void wake_all() {
+            mutex_begin(uqlk, park_lk_);
+            mutex_end();
+            park_cv_.notify_all();
+        }
+
+        /**
+         * Move all tasks in the inbox of worker \c from to the deque of worker
+         * \c tid, and pop one.
+         */
+        bool drain_inbox(tid_t tid, tid_t from, TaskType& task) {
+            auto& q = *queues_[from];
+            if (q.inbox_size.load() == 0) return false;
+            std::vector<TaskType> tasks;
+            {
+                std::unique_lock<lock_t> uqlk(q.inbox_lk, std::try_to_lock);
+                if (!uqlk.owns_lock()) return false;
+                tasks.swap(q.inbox);
+                q.inbox_size.store(0);
+            }
+            if (tasks.empty()) return false;
+            task = tasks.front();
+            for (size_t idx = 1; idx < tasks.size(); idx++) {
+                queues_[tid]->deque.push(tasks[idx]);
+            }
+            if (tasks.size() > 1) {
+                // The others are now stealable, wake parked workers.
+                signal_.fetch_add(1);
+                if (sleepers_.load() > 0) {
+                    wake_all();
+                }
+            }
+            return true;
+        }
+
+        /**
+         * If any task is queued in any deque or inbox. get_task() may miss
+         * them on contention, i.e., a lost steal or a locked inbox.
+         */
+        bool has_task() const {
+            for (const auto& q : queues_) {
+                if (!q->deque.empty() || q->inbox_size.load() > 0) return true;
+            }
+            return false;
+        }
+
+        bool get_task(tid_t tid, TaskType& task) {
+            // Own deque, then own inbox.
+            if (queues_[tid]->deque.pop(task)) return true;
+            if (drain_inbox(tid, tid, task)) return true;
+            // Steal from others.
+            for (uint32_t i = 1; i < num_workers_; i++) {
+                tid_t victim = (tid + i) % num_workers_;
+                if (queues_[victim]->deque.steal(task)) return true;
+                if (drain_inbox(tid, victim, task)) return true;
+            }
+            return false;
+        }
+
+        void task_done() {
+            if (num_tasks_.fetch_sub(1) == 1) {
+                mutex_begin(uqlk, done_lk_);
+                mutex_end();
+                task_done_.notify_all();
+            }
         }
 
         void worker_func(tid_t tid) {
+            this_worker() = WorkerInfo{this, tid};
+            TaskType task;
             while (true) {
-                TaskType task = queues_[tid].dequeue();
-                if (!task) return;
+                uint64_t epoch = signal_.load();
 
-                task();
+                bool found = false;
+                for (uint32_t i = 0; i < SPIN_COUNT && !found; i++) {
+                    found = get_task(tid, task);
+                    if (!found) std::this_thread::yield();
+                }
+                if (found) {
+                    task();
+                    task_done();
+                    continue;
+                }
 
-                mutex_begin(uqlk, st_lk_);
-                assert(num_tasks_ > 0);
-                num_tasks_--;
+                if (stop_.load()) return;
+
+                // Park until new tasks are added. Check again after announcing,
+                // and retry as long as tasks are still queued.
+                sleepers_.fetch_add(1);
+                found = get_task(tid, task);
+                while (!found && has_task()) {
+                    std::this_thread::yield();
+                    found = get_task(tid, task);
+                }
+                if (found) {
+                    sleepers_.fetch_sub(1);
+                    task();
+                    task_done();
+                    continue;
+                }
+                mutex_begin(uqlk, park_lk_);
+                park_cv_.wait(uqlk, [this, epoch]{ return stop_.load() || signal_.load() != epoch; });
                 mutex_end();
-                task_done_.notify_all();
+                sleepers_.fetch_sub(1);
             }
         }
 };
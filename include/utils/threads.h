@@ -6,16 +6,28 @@
  *
  * Use c++11 primitives and routines.
  */
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
 #include <thread>
+#include <vector>
 
 class barrier;
+class tree_barrier;
 
 using thread_t = std::thread;
 using lock_t = std::mutex;
 using cond_t = std::condition_variable;
 using bar_t = barrier;
+using tree_bar_t = tree_barrier;
 
 
 /* Threads */
@@ -27,6 +39,44 @@ using bar_t = barrier;
  */
 
 
+/* Thread affinity */
+/*  CPUs available to this process, grouped by physical package (socket) in
+ *  ascending order of package id. The package topology is read from sysfs,
+ *  and CPUs with unknown package are put into package 0.
+ */
+static inline std::vector<std::vector<int>> cpu_sockets() {
+    std::map<int, std::vector<int>> packages;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return {};
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        int pkg = 0;
+        std::ifstream ifs("/sys/devices/system/cpu/cpu" + std::to_string(cpu)
+                + "/topology/physical_package_id");
+        if (!(ifs >> pkg) || pkg < 0) pkg = 0;
+        packages[pkg].push_back(cpu);
+    }
+    std::vector<std::vector<int>> sockets;
+    for (auto& p : packages) sockets.push_back(std::move(p.second));
+    return sockets;
+}
+
+/*  Pin the calling thread to the set of \c cpus.
+ *
+ *  Return true on success.
+ */
+static inline bool thread_affinity_set(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) == 0) return false;
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+
 /* Mutexes */
 /*  Use member functions lock(), try_lock(), and unlock().
  */
@@ -107,5 +157,134 @@ class barrier {
         std::size_t barCount_;
 };
 
+/* Sense-reversing combining tree barrier */
+/*  Threads arrive at the leaves of a combining tree with fan-in \c fanIn, so
+ *  each arrival counter is shared by at most \c fanIn threads. The last thread
+ *  arriving at the root flips the global sense to release all. Waiting threads
+ *  spin on the global sense for a bounded time, then park on a condition
+ *  variable.
+ */
+class tree_barrier {
+    public:
+        static constexpr int SERIAL_LAST_THREAD = 1;
+
+        /**
+         * Construct the barrier.
+         *
+         * @param threadCount   The number of threads involved in the barrier.
+         * @param fanIn         The fan-in of the combining tree.
+         * @param spinCount     The number of spins before parking.
+         */
+        explicit tree_barrier(const std::size_t threadCount,
+                const std::size_t fanIn = 4, const std::size_t spinCount = 1024)
+            : threadCount_(threadCount), fanIn_(fanIn < 2 ? 2 : fanIn), spinCount_(spinCount),
+              sense_(false), parked_(0)
+        {
+            // Build the tree level by level, leaves first.
+            std::vector<std::size_t> counts;
+            std::vector<std::size_t> parents;
+            std::size_t levelBegin = 0;
+            std::size_t levelChildren = threadCount_ ? threadCount_ : 1;
+            while (true) {
+                std::size_t levelSize = (levelChildren + fanIn_ - 1) / fanIn_;
+                for (std::size_t idx = 0; idx < levelSize; idx++) {
+                    counts.push_back(std::min(fanIn_, levelChildren - idx * fanIn_));
+                    parents.push_back(levelBegin + levelSize + idx / fanIn_);
+                }
+                levelBegin += levelSize;
+                if (levelSize == 1) break;
+                levelChildren = levelSize;
+            }
+            // Root has no parent.
+            parents.back() = INV_NODE;
+
+            nodeCount_ = counts.size();
+            nodes_.reset(new Node[nodeCount_]);
+            for (std::size_t idx = 0; idx < nodeCount_; idx++) {
+                nodes_[idx].fanIn = counts[idx];
+                nodes_[idx].count.store(counts[idx]);
+                nodes_[idx].parent = parents[idx];
+            }
+            senses_.reset(new ThreadSense[threadCount_ ? threadCount_ : 1]);
+        }
+
+        /**
+         * Wait on the barrier.
+         *
+         * @param threadId          Index of the calling thread, in [0, threadCount).
+         * @param onSerialPoint     A callback to be called at the barrier serial point.
+         *
+         * @return      SERIAL_LAST_THREAD if the thread is the last one arriving
+         *              at the barrier, or 0 otherwise.
+         */
+        int wait(const std::size_t threadId, const std::function<void(void)>& onSerialPoint = [](){}) {
+            const bool mySense = !senses_[threadId].sense;
+            senses_[threadId].sense = mySense;
+
+            // Arrive up the tree.
+            std::size_t node = threadId / fanIn_;
+            while (nodes_[node].count.fetch_sub(1) == 1) {
+                // Last one arriving at this node. Reset it for the next round,
+                // which cannot start before the release below.
+                nodes_[node].count.store(nodes_[node].fanIn);
+                if (nodes_[node].parent == INV_NODE) {
+                    // Serial point.
+                    if (onSerialPoint) onSerialPoint();
+                    sense_.store(mySense);
+                    if (parked_.load() > 0) {
+                        mutex_begin(uqlk, mutex_);
+                        mutex_end();
+                        cv_.notify_all();
+                    }
+                    return SERIAL_LAST_THREAD;
+                }
+                node = nodes_[node].parent;
+            }
+
+            // Spin, then park.
+            for (std::size_t i = 0; i < spinCount_; i++) {
+                if (sense_.load(std::memory_order_acquire) == mySense) return 0;
+                if ((i & 0xf) == 0xf) std::this_thread::yield();
+            }
+            parked_.fetch_add(1);
+            mutex_begin(uqlk, mutex_);
+            cv_.wait(uqlk, [this, mySense]{ return sense_.load() == mySense; });
+            mutex_end();
+            parked_.fetch_sub(1);
+            return 0;
+        }
+
+    private:
+        static constexpr std::size_t INV_NODE = static_cast<std::size_t>(-1);
+        static constexpr std::size_t CACHE_LINE = 64;
+
+        struct Node {
+            std::atomic<std::size_t> count;
+            std::size_t fanIn;
+            std::size_t parent;
+            // Avoid false sharing b/w nodes.
+            char pad_[CACHE_LINE - sizeof(std::atomic<std::size_t>) - 2 * sizeof(std::size_t)];
+        };
+
+        struct ThreadSense {
+            bool sense = false;
+            char pad_[CACHE_LINE - sizeof(bool)];
+        };
+
+        const std::size_t threadCount_;
+        const std::size_t fanIn_;
+        const std::size_t spinCount_;
+
+        std::size_t nodeCount_;
+        std::unique_ptr<Node[]> nodes_;
+        std::unique_ptr<ThreadSense[]> senses_;
+
+        std::atomic<bool> sense_;
+
+        std::atomic<std::size_t> parked_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+};
+
 #endif // UTILS_THREADS_H_
 
@@ -1,10 +1,12 @@
+#include <atomic>
+#include <cmath>
 #include "gtest/gtest.h"
 #include "utils/thread_pool.h"
 #include "comm_sync.h"
 
 using namespace GraphGASLite;
 
-class CommSyncTest : public ::testing::Test {
+class CommSyncTest : public ::testing::TestWithParam<CommSync<uint32_t, double>::BarrierType> {
 public:
     typedef CommSync<uint32_t, double> CommSyncType;
     typedef typename CommSyncType::KeyValue KeyValType;
@@ -13,7 +15,7 @@ public:
 protected:
     virtual void SetUp() {
         pool_ = new ThreadPool(threadCount_);
-        cs_ = new CommSyncType(threadCount_, CommSyncType::KeyValue(-1u, 0.));
+        cs_ = new CommSyncType(threadCount_, CommSyncType::KeyValue(-1u, 0.), GetParam());
     }
 
     virtual void TearDown() {
@@ -33,7 +35,7 @@ protected:
     CommSyncType* cs_;
 };
 
-TEST_F(CommSyncTest, barrier) {
+TEST_P(CommSyncTest, barrier) {
     lock_t lock;
     uint32_t curIter = -1;
     uint32_t arrivedThreads = 0;
@@ -58,7 +60,7 @@ TEST_F(CommSyncTest, barrier) {
     RunTask(tf);
 }
 
-TEST_F(CommSyncTest, barrierAND) {
+TEST_P(CommSyncTest, barrierAND) {
     std::vector<bool> inputs(threadCount_, true);
     bool expOutput = true;
 
@@ -81,7 +83,32 @@ TEST_F(CommSyncTest, barrierAND) {
     RunTask(tf);
 }
 
-TEST_F(CommSyncTest, comm) {
+TEST_P(CommSyncTest, barrierReduce) {
+    auto tf = [&](uint32_t tid, CommSyncType* cs) {
+        for (uint32_t iter = 0; iter < 4; iter++) {
+            double val = tid + iter;
+
+            auto sum = cs->barrierReduce<SumCombiner<double>>(tid, val);
+            ASSERT_DOUBLE_EQ(threadCount_ * (threadCount_ - 1) / 2. + threadCount_ * iter, sum);
+
+            auto min = cs->barrierReduce<MinCombiner<double>>(tid, val);
+            ASSERT_DOUBLE_EQ(iter, min);
+
+            auto max = cs->barrierReduce<MaxCombiner<uint32_t>>(tid, tid);
+            ASSERT_EQ(threadCount_ - 1, max);
+
+            auto tup = cs->barrierReduce(tid, std::make_tuple(tid != 3, tid == 5, val),
+                    TupleCombiner<ANDCombiner, ORCombiner, SumCombiner<double>>());
+            ASSERT_FALSE(std::get<0>(tup));
+            ASSERT_TRUE(std::get<1>(tup));
+            ASSERT_DOUBLE_EQ(sum, std::get<2>(tup));
+        }
+    };
+
+    RunTask(tf);
+}
+
+TEST_P(CommSyncTest, comm) {
 
     auto tf = [this](uint32_t tid, CommSyncType* cs) {
 
@@ -149,3 +176,117 @@ TEST_F(CommSyncTest, comm) {
     RunTask(tf);
 }
 
+TEST_P(CommSyncTest, bulk) {
+
+    auto tf = [this](uint32_t tid, CommSyncType* cs) {
+        // Each thread sends to thread \c dstId <tt>tid + dstId</tt> words,
+        // <tt>(tid << 32) + i</tt>, the first one alone.
+        for (uint32_t dstId = 0; dstId < threadCount_; dstId++) {
+            std::vector<uint64_t> words;
+            for (uint32_t i = 0; i < tid + dstId; i++) {
+                words.push_back((uint64_t(tid) << 32) + i);
+            }
+            if (words.empty()) continue;
+            cs->bulkNew(tid, dstId, words[0]);
+            cs->bulkNew(tid, dstId, words.data() + 1, words.size() - 1);
+        }
+
+        cs->barrier(tid);
+
+        for (uint32_t srcId = 0; srcId < threadCount_; srcId++) {
+            const auto& buf = cs->bulk(srcId, tid);
+            ASSERT_EQ(srcId + tid, buf.size());
+            for (uint32_t i = 0; i < buf.size(); i++) {
+                ASSERT_EQ((uint64_t(srcId) << 32) + i, buf[i]);
+            }
+        }
+
+        // All threads have finished reading their own buffers.
+        cs->bulkConsDelAll(tid);
+        for (uint32_t srcId = 0; srcId < threadCount_; srcId++) {
+            ASSERT_TRUE(cs->bulk(srcId, tid).empty());
+        }
+    };
+
+    // Exchange twice in a row to test bulkConsDelAll.
+    RunTask(tf);
+    RunTask(tf);
+}
+
+TEST_P(CommSyncTest, stream) {
+    std::atomic<uint32_t> recvCount(0);
+
+    auto tf = [this, &recvCount](uint32_t tid, CommSyncType* cs) {
+        typename CommSyncType::KeyValueStream s;
+        // Thread 0 starts a token that hops \c hops more times around the
+        // ring. All other threads are idle until the token arrives.
+        const uint32_t hops = 5 * threadCount_;
+        if (tid == 0) {
+            s.put(KeyValType(tid, hops));
+            cs->keyValPost(1 % threadCount_, s);
+            ASSERT_EQ(0, s.size());
+        }
+
+        while (true) {
+            const auto count = cs->keyValTake(tid, s);
+            typename CommSyncType::KeyValueStream fwd;
+            for (const auto& kv : s) {
+                ASSERT_EQ((tid + threadCount_ - 1) % threadCount_, kv.key());
+                recvCount++;
+                if (kv.val() > 0) fwd.put(KeyValType(tid, kv.val() - 1));
+            }
+            if (fwd.size() > 0) cs->keyValPost((tid + 1) % threadCount_, fwd);
+            if (count > 0) cs->keyValTakeDone(count);
+            if (count == 0) {
+                if (cs->streamQuiescent(tid)) break;
+                std::this_thread::yield();
+            }
+        }
+
+        cs->streamEnd(tid);
+        // The token has finished all hops.
+        ASSERT_EQ(5 * threadCount_ + 1, recvCount);
+        cs->barrier(tid);
+        if (tid == 0) recvCount = 0;
+    };
+
+    // Stream twice in a row to test streamEnd.
+    RunTask(tf);
+    RunTask(tf);
+}
+
+INSTANTIATE_TEST_SUITE_P(BarrierType, CommSyncTest,
+        ::testing::Values(CommSyncTest::CommSyncType::BARRIER_BLOCKING,
+            CommSyncTest::CommSyncType::BARRIER_SPIN_TREE));
+
+TEST(TreeBarrierTest, serialPoint) {
+    // Uneven tree with small fan-in.
+    const uint32_t threadCount = 7;
+    tree_bar_t bar(threadCount, 2, 16);
+    std::vector<uint32_t> arrived(threadCount, 0);
+    uint32_t serialCount = 0;
+    std::atomic<uint32_t> lastCount(0);
+
+    ThreadPool pool(threadCount);
+    for (uint32_t tid = 0; tid < threadCount; tid++) {
+        pool.add_task([&, tid]{
+            for (uint32_t iter = 0; iter < 100; iter++) {
+                arrived[tid] = iter + 1;
+                auto ret = bar.wait(tid, [&]{
+                    // All threads have arrived at the serial point.
+                    for (uint32_t idx = 0; idx < threadCount; idx++) {
+                        ASSERT_EQ(iter + 1, arrived[idx]);
+                    }
+                    serialCount++;
+                });
+                if (ret == tree_bar_t::SERIAL_LAST_THREAD) lastCount++;
+                // Serial point is done before anyone leaves.
+                ASSERT_EQ(iter + 1, serialCount);
+                bar.wait(tid);
+            }
+        });
+    }
+    pool.wait_all();
+    ASSERT_EQ(100u, serialCount);
+    ASSERT_EQ(100u, lastCount.load());
+}
@@ -2,6 +2,7 @@
 #include "engine.h"
 #include "graph_io_util.h"
 #include "test_graph_types.h"
+#include "../algo_kernels/edge_centric/sssp/sssp.h"
 
 using namespace GraphGASLite;
 
@@ -33,6 +34,57 @@ protected:
     }
 };
 
+/**
+ * Propagate the minimum vertex label. Labels are negative, as the update
+ * combining takes the minimum with 0.
+ */
+class MinLabelAK : public EdgeCentricAlgoKernel<TestGraphTile> {
+public:
+    MinLabelAK() : EdgeCentricAlgoKernel<TestGraphTile>("minlabel") { }
+    bool asyncAllowed() const { return true; }
+protected:
+    std::pair<TestUpdate, bool> scatter(const IterCount&, Ptr<VertexType>& src, EdgeWeightType&) const {
+        return std::make_pair(TestUpdate(src->data().x_), true);
+    }
+    bool gather(const IterCount&, Ptr<VertexType>& dst, const TestUpdate& update) const {
+        if (update.x_ < dst->data().x_) {
+            dst->data().x_ = update.x_;
+            return false;
+        }
+        return true;
+    }
+    void onAlgoKernelStart(Ptr<TestGraphTile>& graph) const {
+        for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) {
+            vIter->second->data().x_ = -1. - vIter->second->vid();
+        }
+    }
+};
+
+/**
+ * Same as MinLabelAK, with scatter and gather resolved at compile time.
+ */
+class StaticMinLabelAK : public EdgeCentricAlgoKernel<TestGraphTile, StaticMinLabelAK> {
+    friend class EdgeCentricAlgoKernel<TestGraphTile, StaticMinLabelAK>;
+public:
+    StaticMinLabelAK() : EdgeCentricAlgoKernel<TestGraphTile, StaticMinLabelAK>("staticminlabel") { }
+protected:
+    std::pair<TestUpdate, bool> scatter(const IterCount&, Ptr<VertexType>& src, EdgeWeightType&) const {
+        return std::make_pair(TestUpdate(src->data().x_), true);
+    }
+    bool gather(const IterCount&, Ptr<VertexType>& dst, const TestUpdate& update) const {
+        if (update.x_ < dst->data().x_) {
+            dst->data().x_ = update.x_;
+            return false;
+        }
+        return true;
+    }
+    void onAlgoKernelStart(Ptr<TestGraphTile>& graph) const {
+        for (auto vIter = graph->vertexIter(); vIter != graph->vertexIterEnd(); ++vIter) {
+            vIter->second->data().x_ = -1. - vIter->second->vid();
+        }
+    }
+};
+
 class EngineTest : public ::testing::Test {
 public:
     typedef Engine<TestGraphTile> EngineType;
@@ -127,3 +179,198 @@ TEST_F(EngineTest, algoKernelDel) {
     }
 }
 
+
+TEST_F(EngineTest, run) {
+    engine_->algoKernelNew(Ptr<MinLabelAK>(new MinLabelAK));
+    (*engine_)();
+
+    for (size_t idx = 0; idx < engine_->graphTileCount(); idx++) {
+        auto g = engine_->graphTile(idx);
+        for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+            ASSERT_EQ(-4, vIter->second->data().x_);
+        }
+    }
+}
+
+TEST_F(EngineTest, runStatic) {
+    engine_->algoKernelNew(Ptr<StaticMinLabelAK>(new StaticMinLabelAK));
+    (*engine_)();
+
+    for (size_t idx = 0; idx < engine_->graphTileCount(); idx++) {
+        auto g = engine_->graphTile(idx);
+        for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+            ASSERT_EQ(-4, vIter->second->data().x_);
+        }
+    }
+}
+
+TEST_F(EngineTest, runRepeated) {
+    // Only run the label kernel.
+    while (engine_->algoKernelCount() > 0) engine_->algoKernelDel(engine_->algoKernelIter());
+    engine_->algoKernelNew(Ptr<MinLabelAK>(new MinLabelAK));
+    engine_->workerCountIs(1);
+    for (int run = 0; run < 3; run++) {
+        (*engine_)();
+
+        for (size_t idx = 0; idx < engine_->graphTileCount(); idx++) {
+            auto g = engine_->graphTile(idx);
+            for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+                ASSERT_EQ(-4, vIter->second->data().x_);
+                // Clear results, so the next run must recompute them.
+                vIter->second->data().x_ = 0;
+            }
+        }
+
+        // Change kernels and workers b/w runs.
+        if (run == 0) {
+            engine_->algoKernelDel(engine_->algoKernelIter());
+            engine_->algoKernelNew(Ptr<StaticMinLabelAK>(new StaticMinLabelAK));
+        }
+        if (run == 1) engine_->workerCountIs(2);
+        ASSERT_EQ(1, engine_->algoKernelCount());
+    }
+}
+
+TEST(EngineSSSPTest, runRepeatedSources) {
+    typedef GraphTile<SSSPData<uint32_t>, SSSPUpdate<uint32_t>, uint32_t> GraphTileType;
+    typedef SSSPEdgeCentricAlgoKernel<GraphTileType> AlgoKernelType;
+    Engine<GraphTileType> engine;
+    engine.graphTileIs(GraphIOUtil::graphTilesFromEdgeList<GraphTileType>(
+                2, "test_graphs/small.dat", "test_graphs/small.part", 1, false, 1, true));
+
+    // Distances from vertex 0, then from vertex 3 on the same engine.
+    const uint32_t expected[2][4] = {{0, 1, 2, 2}, {1, 2, 3, 0}};
+    const VertexIdx srcs[2] = {0, 3};
+    for (int run = 0; run < 2; run++) {
+        while (engine.algoKernelCount() > 0) engine.algoKernelDel(engine.algoKernelIter());
+        engine.algoKernelNew(AlgoKernelType::instanceNew("sssp", srcs[run]));
+        engine();
+
+        for (size_t idx = 0; idx < engine.graphTileCount(); idx++) {
+            auto g = engine.graphTile(idx);
+            for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+                ASSERT_EQ(expected[run][vIter->second->vid()], vIter->second->data().distance);
+            }
+        }
+    }
+}
+
+TEST_F(EngineTest, runDynamic) {
+    engine_->graphTileIs(GraphIOUtil::graphTilesFromEdgeList<TestGraphTile>(
+                4, "test_graphs/small.dat", "test_graphs/small4.part", 0, false, 1, true, 0));
+    engine_->algoKernelNew(Ptr<MinLabelAK>(new MinLabelAK));
+    for (size_t workerCount = 1; workerCount <= 4; workerCount++) {
+        engine_->workerCountIs(workerCount);
+        (*engine_)();
+
+        for (size_t idx = 0; idx < engine_->graphTileCount(); idx++) {
+            auto g = engine_->graphTile(idx);
+            for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+                ASSERT_EQ(-4, vIter->second->data().x_);
+            }
+        }
+    }
+}
+
+TEST_F(EngineTest, runAsync) {
+    auto ak = Ptr<MinLabelAK>(new MinLabelAK);
+    ak->asyncIs(true);
+    engine_->algoKernelNew(ak);
+    (*engine_)();
+
+    for (size_t idx = 0; idx < engine_->graphTileCount(); idx++) {
+        auto g = engine_->graphTile(idx);
+        for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+            ASSERT_EQ(-4, vIter->second->data().x_);
+        }
+    }
+}
+
+TEST_F(EngineTest, runAsyncDynamic) {
+    engine_->graphTileIs(GraphIOUtil::graphTilesFromEdgeList<TestGraphTile>(
+                4, "test_graphs/small.dat", "test_graphs/small4.part", 0, false, 1, true, 0));
+    auto ak = Ptr<MinLabelAK>(new MinLabelAK);
+    ak->asyncIs(true);
+    engine_->algoKernelNew(ak);
+    // Streaming with 4 workers, local updates only otherwise.
+    for (size_t workerCount = 1; workerCount <= 4; workerCount++) {
+        engine_->workerCountIs(workerCount);
+        (*engine_)();
+
+        for (size_t idx = 0; idx < engine_->graphTileCount(); idx++) {
+            auto g = engine_->graphTile(idx);
+            for (auto vIter = g->vertexIter(); vIter != g->vertexIterEnd(); ++vIter) {
+                ASSERT_EQ(-4, vIter->second->data().x_);
+            }
+        }
+    }
+}
+
+TEST_F(EngineTest, asyncNotAllowed) {
+    auto ak = Ptr<AK1>(new AK1);
+    try {
+        ak->asyncIs(true);
+    } catch (PermissionException& e) {
+        ASSERT_FALSE(ak->async());
+        return;
+    }
+    // Never reached.
+    ASSERT_TRUE(false);
+}
+
+TEST(TileSchedulerTest, tileForEach) {
+    const uint32_t tileCount = 7;
+    for (uint32_t workerCount = 1; workerCount <= tileCount; workerCount++) {
+        TileScheduler sched(tileCount, workerCount);
+        ASSERT_EQ(workerCount < tileCount, sched.dynamic());
+        // Run phases sequentially as if separated by barriers.
+        for (uint32_t phase = 0; phase < 3; phase++) {
+            std::vector<uint32_t> counts(tileCount, 0);
+            for (uint32_t workerId = 0; workerId < workerCount; workerId++) {
+                sched.tileForEach(workerId, [&counts](const uint32_t idx) {
+                    counts[idx]++;
+                });
+            }
+            for (uint32_t idx = 0; idx < tileCount; idx++) {
+                ASSERT_EQ(1u, counts[idx]);
+            }
+        }
+    }
+}
+
+TEST(TileSchedulerTest, homeTileFirst) {
+    const uint32_t tileCount = 7;
+    const uint32_t workerCount = 3;
+    TileScheduler sched(tileCount, workerCount);
+    sched.tileOrderIs({6, 5, 4, 3, 2, 1, 0});
+    for (uint32_t first = 0; first < workerCount; first++) {
+        // The first worker claims its home tiles, and then all the others.
+        std::vector<uint32_t> claimed;
+        sched.tileForEach(first, [&claimed](const uint32_t idx) {
+            claimed.push_back(idx);
+        });
+        ASSERT_EQ(tileCount, claimed.size());
+        size_t pos = 0;
+        for (uint32_t idx = first; idx < tileCount; idx += workerCount) {
+            ASSERT_EQ(idx, claimed[pos++]);
+        }
+        for (uint32_t workerId = 0; workerId < workerCount; workerId++) {
+            if (workerId == first) continue;
+            sched.tileForEach(workerId, [](const uint32_t) {
+                ASSERT_TRUE(false);
+            });
+        }
+    }
+}
+
+TEST(TileSchedulerTest, tileOrderIsInvalid) {
+    TileScheduler sched(3, 2);
+    try {
+        sched.tileOrderIs({0, 2, 2});
+    } catch (InvalidArgumentException& e) {
+        ASSERT_EQ(3u, sched.tileOrder().size());
+        return;
+    }
+    // Never reached.
+    ASSERT_TRUE(false);
+}
@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "graph.h"
+#include "csc_tile.h"
 #include "graph_io_util.h"
 #include "test_graph_types.h"
 
@@ -19,11 +20,10 @@ protected:
     void degreeSync() {
         for (auto& g : graphs_) {
             for (auto mvIter = g->mirrorVertexIter(); mvIter != g->mirrorVertexIterEnd(); ++mvIter) {
-                auto mv = mvIter->second;
-                auto vid = mv->vid();
-                auto masterTid = mv->masterTileId();
-                graphs_[masterTid]->vertex(vid)->inDegInc(mv->accDeg());
-                mv->accDegDel();
+                auto vid = mvIter->vid();
+                auto masterTid = mvIter->masterTileId();
+                graphs_[masterTid]->vertex(vid)->inDegInc(mvIter->accDeg());
+                mvIter->accDegDel();
             }
         }
     }
@@ -91,8 +91,7 @@ TEST_F(GraphTest, mirrorVertexIter) {
     auto g = graphs_[0];
     size_t count = 0;
     for (auto mvIter = g->mirrorVertexIter(); mvIter != g->mirrorVertexIterEnd(); ++mvIter) {
-        auto mv = mvIter->second;
-        ASSERT_EQ(1, mv->masterTileId());
+        ASSERT_EQ(1, mvIter->masterTileId());
         count++;
     }
     ASSERT_EQ(2, count);
@@ -236,3 +235,180 @@ try2: try {
     ASSERT_TRUE(false);
 }
 
+
+TEST_F(GraphTest, mirrorVertexAt) {
+    auto g = graphs_[0];
+    ASSERT_EQ(2, g->mirrorVertexCount());
+    for (auto eIter = g->edgeIter(); eIter != g->edgeIterEnd(); ++eIter) {
+        auto& e = *eIter;
+        if (g->hasVertex(e.dstId())) {
+            ASSERT_EQ(INV_MIRROR_VERTEX_IDX, e.dstMirrorIdx());
+        } else {
+            ASSERT_EQ(e.dstId(), g->mirrorVertexAt(e.dstMirrorIdx()).vid());
+        }
+    }
+}
+
+TEST_F(GraphTest, mirrorVertexRange) {
+    degreeSync();
+    for (auto& g : graphs_) {
+        g->finalizedIs(true);
+    }
+
+    // Mirror vertices are grouped by master tile after finalized.
+    auto range = graphs_[0]->mirrorVertexRange(1);
+    ASSERT_EQ(0, range.first);
+    ASSERT_EQ(2, range.second);
+    ASSERT_EQ(2, graphs_[0]->mirrorVertexAt(0).vid());
+    ASSERT_EQ(3, graphs_[0]->mirrorVertexAt(1).vid());
+    range = graphs_[0]->mirrorVertexRange(0);
+    ASSERT_EQ(range.first, range.second);
+    range = graphs_[1]->mirrorVertexRange(0);
+    ASSERT_EQ(1, range.second - range.first);
+    ASSERT_EQ(0, graphs_[1]->mirrorVertexAt(range.first).vid());
+    range = graphs_[1]->mirrorVertexRange(5);
+    ASSERT_EQ(range.first, range.second);
+
+    // Lookup by vertex index follows the grouping.
+    ASSERT_EQ(&graphs_[0]->mirrorVertexAt(1), graphs_[0]->mirrorVertex(3));
+
+    // Edges still reference the correct mirror vertices.
+    for (auto& g : graphs_) {
+        for (auto eIter = g->edgeIter(); eIter != g->edgeIterEnd(); ++eIter) {
+            auto& e = *eIter;
+            if (e.dstMirrorIdx() != INV_MIRROR_VERTEX_IDX) {
+                ASSERT_EQ(e.dstId(), g->mirrorVertexAt(e.dstMirrorIdx()).vid());
+            }
+        }
+    }
+}
+
+TEST_F(GraphTest, mirrorVertexRangeNotFinalized) {
+    try {
+        graphs_[0]->mirrorVertexRange(1);
+    } catch (PermissionException& e) {
+        return;
+    }
+
+    // Never reached.
+    ASSERT_TRUE(false);
+}
+
+TEST_F(GraphTest, mirrorVertexDirtyList) {
+    degreeSync();
+    auto g = graphs_[0];
+    g->finalizedIs(true);
+    ASSERT_TRUE(g->mirrorVertexDirtyList().empty());
+
+    auto mv3 = g->mirrorVertex(3);
+    mv3->updateNew(TestUpdate(2));
+    mv3->updateNew(TestUpdate(1));
+    ASSERT_EQ(1, g->mirrorVertexDirtyList().size());
+    ASSERT_EQ(3, g->mirrorVertexAt(g->mirrorVertexDirtyList()[0]).vid());
+    ASSERT_TRUE(mv3->hasUpdate());
+    ASSERT_FALSE(g->mirrorVertex(2)->hasUpdate());
+
+    g->mirrorVertexDirtyDelAll();
+    ASSERT_TRUE(g->mirrorVertexDirtyList().empty());
+    ASSERT_FALSE(mv3->hasUpdate());
+
+    // Recorded once again after reset.
+    mv3->updateNew(TestUpdate(-4));
+    mv3->updateNew(TestUpdate(-1));
+    ASSERT_EQ(1, g->mirrorVertexDirtyList().size());
+    ASSERT_EQ(-4, mv3->accUpdate().x_);
+}
+
+TEST_F(GraphTest, reallocLocal) {
+    degreeSync();
+    auto g = graphs_[0];
+    g->finalizedIs(true);
+    g->vertex(1)->data().x_ = 5;
+    g->mirrorVertex(3)->updateNew(TestUpdate(-2));
+
+    auto vOld = g->vertex(1);
+    g->reallocLocal();
+
+    auto v = g->vertex(1);
+    ASSERT_NE(vOld, v);
+    ASSERT_EQ(1, v->vid());
+    ASSERT_EQ(5, v->data().x_);
+    ASSERT_EQ(vOld->inDeg(), v->inDeg());
+    ASSERT_EQ(vOld->outDeg(), v->outDeg());
+    ASSERT_EQ(2, g->vertexCount());
+    ASSERT_EQ(3, g->edgeCount());
+
+    // Mirror vertices keep dense indices and pending updates.
+    ASSERT_EQ(2, g->mirrorVertexCount());
+    auto mv3 = g->mirrorVertex(3);
+    ASSERT_EQ(mv3, &g->mirrorVertexAt(1));
+    ASSERT_TRUE(mv3->hasUpdate());
+    ASSERT_EQ(-2, mv3->accUpdate().x_);
+    ASSERT_EQ(1, g->mirrorVertexDirtyList().size());
+    mv3->updateNew(TestUpdate(-3));
+    mv3 = nullptr;
+    g->mirrorVertex(2)->updateNew(TestUpdate(-1));
+    ASSERT_EQ(2, g->mirrorVertexDirtyList().size());
+    g->mirrorVertexDirtyDelAll();
+    ASSERT_FALSE(g->mirrorVertex(3)->hasUpdate());
+}
+
+TEST_F(GraphTest, reallocLocalNotFinalized) {
+    try {
+        graphs_[0]->reallocLocal();
+    } catch (PermissionException& e) {
+        return;
+    }
+
+    // Never reached.
+    ASSERT_TRUE(false);
+}
+
+TEST_F(GraphTest, cscTile) {
+    degreeSync();
+    auto g = graphs_[1];
+    g->finalizedIs(true);
+    CSCTile<TestGraphTile> csc(g);
+
+    // Local vertices 2 and 3, then mirror vertex 0.
+    ASSERT_EQ(2, csc.vertexCount());
+    ASSERT_EQ(3, csc.targetCount());
+    const auto idx2 = csc.vertexIdx(2);
+    const auto idx3 = csc.vertexIdx(3);
+    ASSERT_EQ(2, csc.vertexAt(idx2)->vid());
+    ASSERT_EQ(3, csc.vertexAt(idx3)->vid());
+
+    const auto& offsets = csc.inEdgeOffsets();
+    const auto& srcs = csc.inEdgeSrcs();
+    ASSERT_EQ(g->edgeCount(), srcs.size());
+    // 2 -> 3.
+    ASSERT_EQ(0, offsets[idx2 + 1] - offsets[idx2]);
+    ASSERT_EQ(1, offsets[idx3 + 1] - offsets[idx3]);
+    ASSERT_EQ(idx2, srcs[offsets[idx3]]);
+    // 2 -> 0, 3 -> 0.
+    ASSERT_EQ(0, g->mirrorVertexAt(0).vid());
+    ASSERT_EQ(2, offsets[3] - offsets[2]);
+    ASSERT_EQ(idx2 + idx3, srcs[offsets[2]] + srcs[offsets[2] + 1]);
+
+    const auto& outOffsets = csc.outEdgeOffsets();
+    const auto& targets = csc.outEdgeTargets();
+    ASSERT_EQ(g->edgeCount(), targets.size());
+    // 2 -> 0, 2 -> 3, in the order of the tile edges.
+    ASSERT_EQ(2, outOffsets[idx2 + 1] - outOffsets[idx2]);
+    ASSERT_EQ(2, targets[outOffsets[idx2]]);
+    ASSERT_EQ(idx3, targets[outOffsets[idx2] + 1]);
+    // 3 -> 0.
+    ASSERT_EQ(1, outOffsets[idx3 + 1] - outOffsets[idx3]);
+    ASSERT_EQ(2, targets[outOffsets[idx3]]);
+}
+
+TEST_F(GraphTest, cscTileNotFinalized) {
+    try {
+        CSCTile<TestGraphTile> csc(graphs_[0]);
+    } catch (PermissionException& e) {
+        return;
+    }
+
+    // Never reached.
+    ASSERT_TRUE(false);
+}
@@ -0,0 +1,94 @@
+#include <atomic>
+#include "gtest/gtest.h"
+#include "utils/thread_pool.h"
+
+class ThreadPoolTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        pool_ = new ThreadPool(threadCount_);
+    }
+
+    virtual void TearDown() {
+        delete pool_;
+    }
+
+    const uint32_t threadCount_ = 4;
+    ThreadPool* pool_;
+};
+
+TEST_F(ThreadPoolTest, inlineTask) {
+    std::atomic<uint32_t> count(0);
+    for (uint32_t idx = 0; idx < 1000; idx++) {
+        pool_->add_task([&count, idx]{ count += idx; });
+    }
+    pool_->wait_all();
+    ASSERT_EQ(999u * 1000u / 2, count.load());
+}
+
+TEST_F(ThreadPoolTest, heapTask) {
+    std::atomic<uint32_t> count(0);
+    auto vec = std::make_shared<std::vector<uint32_t>>(100, 1);
+    for (uint32_t idx = 0; idx < 100; idx++) {
+        // Capture shared_ptr, not trivially copyable.
+        pool_->add_task([&count, vec, idx]{ count += (*vec)[idx]; });
+    }
+    pool_->wait_all();
+    ASSERT_EQ(100u, count.load());
+    ASSERT_EQ(1, vec.use_count());
+}
+
+TEST_F(ThreadPoolTest, pinnedTask) {
+    std::atomic<uint32_t> count(0);
+    for (uint32_t idx = 0; idx < 100; idx++) {
+        pool_->add_task([&count]{ count++; }, idx % threadCount_);
+    }
+    pool_->wait_all();
+    ASSERT_EQ(100u, count.load());
+}
+
+TEST_F(ThreadPoolTest, nestedTask) {
+    // Tasks added from workers go to their own deques, and are stolen by others.
+    std::atomic<uint32_t> count(0);
+    auto pool = pool_;
+    for (uint32_t idx = 0; idx < 4; idx++) {
+        pool_->add_task([&count, pool]{
+            for (uint32_t jdx = 0; jdx < 500; jdx++) {
+                pool->add_task([&count]{ count++; });
+            }
+        });
+    }
+    pool_->wait_all();
+    ASSERT_EQ(2000u, count.load());
+}
+
+TEST_F(ThreadPoolTest, waitAllRepeated) {
+    std::atomic<uint32_t> count(0);
+    for (uint32_t round = 0; round < 50; round++) {
+        for (uint32_t idx = 0; idx < threadCount_; idx++) {
+            pool_->add_task([&count]{ count++; });
+        }
+        pool_->wait_all();
+        ASSERT_EQ((round + 1) * threadCount_, count.load());
+    }
+}
+
+TEST_F(ThreadPoolTest, inboxTaskStolen) {
+    // Let all workers park first.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // All tasks go to one inbox, and each waits for all of them to run
+    // concurrently, so they must be spread over all workers.
+    std::atomic<uint32_t> running(0);
+    std::atomic<uint32_t> count(0);
+    for (uint32_t idx = 0; idx < threadCount_; idx++) {
+        pool_->add_task([this, &running, &count]{
+            running++;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (running.load() < threadCount_ && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            if (running.load() == threadCount_) count++;
+        }, 0);
+    }
+    pool_->wait_all();
+    ASSERT_EQ(threadCount_, count.load());
+}